@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+
+#include "Code.h"
+#include "Feedback.h"
+
+
+// AdversarialFeedbackCalculator: commits to no secret, every feedback keeps the largest
+// set of consistent codes alive. Playing a single game against it gives one long game of
+// the solver, a lower bound on its worst case: the largest set is not always the longest.
+template <class Counter, class FrequencyMap>
+class AdversarialFeedbackCalculator {
+    const std::uint8_t pegs;
+    Counter counter;
+public:
+    AdversarialFeedbackCalculator(std::uint8_t pegs, std::uint8_t colors)
+        : pegs(pegs)
+        , counter(pegs, colors)
+    {}
+
+    Feedback get_feedback(const Code& guess, const FrequencyMap& guess_frequency_map) {
+        const auto histogram = counter.partition(guess, guess_frequency_map);
+
+        // Largest class, ties going to the fewest black pegs
+        const size_t stride = pegs + 1;
+        size_t best = 0;
+        for (size_t i = 1; i < histogram.size(); ++i) {
+            if (histogram[i] > histogram[best]) {
+                best = i;
+            }
+        }
+
+        const Feedback feedback(static_cast<unsigned int>(best / stride), static_cast<unsigned int>(best % stride));
+        counter.add_constraint(guess, guess_frequency_map, feedback);
+        return feedback;
+    }
+};
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <concepts>
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <ostream>
+#include <span>
+#include <sstream>
+#include <vector>
+
+#include "Code.h"
+#include "Feedback.h"
+
+
+// Solvers whose state can be saved and loaded back, so that a group of games can fork
+template <class Solver>
+concept Checkpointable = requires(Solver& solver, std::ostream& output, std::istream& input) {
+    solver.save(output);
+    solver.load(input);
+};
+
+// BatchSolver: solves many secrets of the same board in lockstep. Games with the same guesses and feedbacks
+// so far share one solver, so each state of the strategy tree is searched once for the whole batch, which
+// walks the tree breadth first. A group forks through a checkpoint of its solver when its feedbacks differ.
+template <Checkpointable Solver>
+class BatchSolver {
+public:
+    struct Result {
+        Code final_guess;
+        unsigned int nb_guesses;
+    };
+
+private:
+    struct Group {
+        std::unique_ptr<Solver> solver;
+        std::vector<size_t> games;
+    };
+
+    const std::uint8_t pegs;
+    const std::uint8_t colors;
+
+public:
+    BatchSolver(std::uint8_t pegs, std::uint8_t colors)
+        : pegs(pegs)
+        , colors(colors)
+    {}
+
+    // Results in the order of the secrets, the final guess is empty for a game the solver could not finish
+    std::vector<Result> solve(std::span<const Code> secrets) const
+    {
+        std::vector<Result> results(secrets.size());
+        std::vector<Group> groups;
+        groups.emplace_back(std::make_unique<Solver>(pegs, colors), std::vector<size_t>(secrets.size()));
+        std::iota(groups.front().games.begin(), groups.front().games.end(), size_t{ 0 });
+
+        for (unsigned int nb_guesses = 1; !groups.empty(); ++nb_guesses) {
+            std::vector<Group> next_groups;
+            for (auto& [solver, games] : groups) {
+                const auto& [guess, guess_frequency_map] = solver->next_guess();
+                if (!solver->can_continue()) {
+                    for (const size_t game : games) {
+                        results[game].nb_guesses = nb_guesses - 1;
+                    }
+                    continue;
+                }
+
+                auto feedback_calculator = solver->get_feedback_calculator();
+                std::map<Feedback, std::vector<size_t>, std::greater<>> branches;
+                for (const size_t game : games) {
+                    feedback_calculator.set_secret(secrets[game]);
+                    const Feedback feedback = feedback_calculator.get_feedback(guess, guess_frequency_map);
+                    if (feedback.black() == pegs) {
+                        results[game] = { guess, nb_guesses };
+                    }
+                    else {
+                        branches[feedback].push_back(game);
+                    }
+                }
+
+                if (branches.empty()) {
+                    continue;
+                }
+
+                // Every branch but the last one starts from a copy of the solver, the last one takes the solver over
+                std::string checkpoint;
+                if (branches.size() > 1) {
+                    std::ostringstream stream;
+                    solver->save(stream);
+                    checkpoint = std::move(stream).str();
+                }
+
+                for (auto it = branches.begin(); it != branches.end(); ++it) {
+                    auto& [feedback, branch_games] = *it;
+                    std::unique_ptr<Solver> branch_solver;
+                    if (std::next(it) == branches.end()) {
+                        branch_solver = std::move(solver);
+                    }
+                    else {
+                        branch_solver = std::make_unique<Solver>(pegs, colors);
+                        std::istringstream stream(checkpoint);
+                        branch_solver->load(stream);
+                    }
+
+                    branch_solver->apply_feedback(feedback);
+                    next_groups.emplace_back(std::move(branch_solver), std::move(branch_games));
+                }
+            }
+            groups = std::move(next_groups);
+        }
+
+        return results;
+    }
+};
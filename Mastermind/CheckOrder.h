@@ -0,0 +1,76 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+
+// CheckOrder: order in which the history entries are checked at one depth of the search.
+// Entries are reordered online by their rejection rate so the most discriminating ones
+// are checked first; a node is kept only if every entry accepts it, so the order never
+// changes the result.
+template <typename Entry>
+class CheckOrder {
+public:
+    struct Check {
+        const Entry* entry;
+        std::uint64_t nb_checks;
+        std::uint64_t nb_rejections;
+    };
+
+private:
+    static constexpr std::uint64_t reorder_period = 1024;
+
+    std::vector<Check> checks;
+    std::uint64_t nb_nodes_until_reorder = reorder_period;
+
+public:
+    // New entries have no statistics yet, they are checked first until their rate is known
+    void add(const Entry& entry) {
+        checks.insert(checks.begin(), Check{ &entry, 0, 0 });
+    }
+
+    const std::vector<Check>& get_checks() const { return checks; }
+    std::uint64_t get_nb_nodes_until_reorder() const { return nb_nodes_until_reorder; }
+
+    // Order and statistics of a checkpoint, the entries must outlive the order
+    void restore(std::vector<Check> saved_checks, std::uint64_t saved_nb_nodes_until_reorder) {
+        checks = std::move(saved_checks);
+        nb_nodes_until_reorder = saved_nb_nodes_until_reorder;
+    }
+
+    template <typename Pred>
+    inline bool all_of(Pred pred) {
+        bool accepted = true;
+        for (Check& check : checks) {
+            ++check.nb_checks;
+            if (!pred(*check.entry)) {
+                ++check.nb_rejections;
+                accepted = false;
+                break;
+            }
+        }
+
+        if (--nb_nodes_until_reorder == 0) {
+            reorder();
+        }
+
+        return accepted;
+    }
+
+private:
+    void reorder() {
+        // Rates are smoothed so that entries with few checks are neither favored nor buried
+        std::ranges::stable_sort(checks, std::greater<>{}, [](const Check& check) {
+            return (check.nb_rejections + 1.0) / (check.nb_checks + 2.0);
+        });
+
+        // Halving the statistics lets the order follow the search as it moves
+        for (Check& check : checks) {
+            check.nb_checks /= 2;
+            check.nb_rejections /= 2;
+        }
+
+        nb_nodes_until_reorder = reorder_period;
+    }
+};
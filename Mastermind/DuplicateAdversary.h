@@ -0,0 +1,12 @@
+#pragma once
+
+#include "AdversarialFeedbackCalculator.h"
+#include "DuplicateCounter.h"
+#include "DuplicateSolver.h"
+
+
+namespace duplicate {
+
+using AdversarialFeedbackCalculator = ::AdversarialFeedbackCalculator<Counter, FrequencyMap>;
+
+}
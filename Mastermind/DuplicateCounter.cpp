@@ -0,0 +1,241 @@
+#include "DuplicateCounter.h"
+#include "Saturating.h"
+#include <algorithm>
+#include <random>
+
+
+namespace duplicate {
+
+Counter::Counter(std::uint8_t pegs, std::uint8_t colors)
+    : pegs(pegs)
+    , colors(colors)
+    , caps(colors, 0)
+    , nb_irrelevant_colors(colors)
+    , counts(colors, 0)
+{}
+
+void Counter::add_constraint(const Code& guess, const FrequencyMap& guess_frequency_map, const Feedback& feedback) {
+    constraints.emplace_back(
+        Code(guess.begin(), guess.begin() + pegs),
+        std::vector<std::uint8_t>(guess_frequency_map.begin(), guess_frequency_map.begin() + colors),
+        static_cast<std::uint8_t>(feedback.black()),
+        static_cast<std::uint8_t>(feedback.black() + feedback.white()));
+}
+
+std::uint64_t Counter::count() {
+    prepare();
+    return count_from(0);
+}
+
+double Counter::estimate(unsigned int nb_probes, unsigned int seed) {
+    prepare();
+
+    std::mt19937 rng(seed);
+    std::vector<Color> candidates;
+    candidates.reserve(colors);
+    std::vector<Color> path;
+    path.reserve(pegs);
+
+    double sum = 0.0;
+    for (unsigned int probe = 0; probe < nb_probes; ++probe) {
+        double weight = 1.0;
+        for (size_t position = 0; position < pegs; ++position) {
+            const size_t remaining = pegs - position - 1;
+            candidates.clear();
+            for (Color color : relevant_colors) {
+                place(color, position);
+                if (is_feasible(remaining)) {
+                    candidates.push_back(color);
+                }
+                unplace(color, position);
+            }
+
+            // Irrelevant colors are interchangeable, they are checked once and weighted by their number
+            const size_t nb_irrelevant = nb_irrelevant_colors != 0 && is_feasible(remaining) ? nb_irrelevant_colors : 0;
+            const size_t nb_children = candidates.size() + nb_irrelevant;
+            if (nb_children == 0) {
+                weight = 0.0;
+                break;
+            }
+
+            weight *= static_cast<double>(nb_children);
+            const size_t child = std::uniform_int_distribution<size_t>(0, nb_children - 1)(rng);
+            const Color color = child < candidates.size() ? candidates[child] : colors;
+            if (color != colors) {
+                place(color, position);
+            }
+            path.push_back(color);
+        }
+
+        sum += weight;
+
+        for (size_t position = path.size(); position-- > 0;) {
+            if (path[position] != colors) {
+                unplace(path[position], position);
+            }
+        }
+        path.clear();
+    }
+
+    return nb_probes == 0 ? 0.0 : sum / nb_probes;
+}
+
+std::vector<std::uint64_t> Counter::partition(const Code& guess, const FrequencyMap& guess_frequency_map) {
+    probe.assign(guess.begin(), guess.begin() + pegs);
+    probe_counts.assign(guess_frequency_map.begin(), guess_frequency_map.begin() + colors);
+    prepare(probe_counts);
+
+    const size_t stride = pegs + 1;
+    consistent_leaf.assign(stride * stride, 0);
+    consistent_leaf[0] = 1;
+    inconsistent_leaf.assign(stride * stride, 0);
+    partition_memo.assign(pegs, {});
+
+    // Histogram over (black, black + white) to histogram over (black, white)
+    const auto& totals_histogram = partition_from(0);
+    std::vector<std::uint64_t> histogram(stride * stride, 0);
+    for (size_t black = 0; black <= pegs; ++black) {
+        for (size_t total = black; total <= pegs; ++total) {
+            histogram[black * stride + total - black] = totals_histogram[black * stride + total];
+        }
+    }
+    return histogram;
+}
+
+void Counter::prepare(std::span<const std::uint8_t> extra_counts) {
+    std::ranges::copy(extra_counts, caps.begin());
+    std::fill(caps.begin() + extra_counts.size(), caps.end(), 0);
+    for (const auto& constraint : constraints) {
+        for (Color color = 0; color < colors; ++color) {
+            caps[color] = std::max(caps[color], constraint.guess_counts[color]);
+        }
+    }
+
+    relevant_colors.clear();
+    for (Color color = 0; color < colors; ++color) {
+        if (caps[color] != 0) {
+            relevant_colors.push_back(color);
+        }
+    }
+    nb_irrelevant_colors = static_cast<std::uint8_t>(colors - relevant_colors.size());
+
+    blacks.assign(constraints.size(), 0);
+    totals.assign(constraints.size(), 0);
+    std::ranges::fill(counts, 0);
+    memo.assign(pegs, {});
+}
+
+void Counter::place(Color color, size_t position) {
+    for (size_t i = 0; i < constraints.size(); ++i) {
+        blacks[i] += constraints[i].guess[position] == color;
+        totals[i] += counts[color] < constraints[i].guess_counts[color];
+    }
+    ++counts[color];
+}
+
+void Counter::unplace(Color color, size_t position) {
+    --counts[color];
+    for (size_t i = 0; i < constraints.size(); ++i) {
+        blacks[i] -= constraints[i].guess[position] == color;
+        totals[i] -= counts[color] < constraints[i].guess_counts[color];
+    }
+}
+
+bool Counter::is_feasible(size_t remaining) const {
+    for (size_t i = 0; i < constraints.size(); ++i) {
+        const Constraint& constraint = constraints[i];
+        if (blacks[i] > constraint.black || blacks[i] + remaining < constraint.black
+            || totals[i] > constraint.total || totals[i] + remaining < constraint.total) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Counter::is_consistent() const {
+    return is_feasible(0);
+}
+
+std::vector<std::uint8_t> Counter::make_key() const {
+    std::vector<std::uint8_t> key(blacks);
+    key.reserve(blacks.size() + relevant_colors.size());
+    for (Color color : relevant_colors) {
+        key.push_back(std::min(counts[color], caps[color]));
+    }
+    return key;
+}
+
+std::uint64_t Counter::count_from(size_t position) {
+    if (position == pegs) {
+        return is_consistent() ? 1 : 0;
+    }
+
+    auto key = make_key();
+    auto& position_memo = memo[position];
+    if (const auto it = position_memo.find(key); it != position_memo.end()) {
+        return it->second;
+    }
+
+    const size_t remaining = pegs - position - 1;
+    std::uint64_t count = 0;
+    for (Color color : relevant_colors) {
+        place(color, position);
+        if (is_feasible(remaining)) {
+            count = saturating_add(count, count_from(position + 1));
+        }
+        unplace(color, position);
+    }
+
+    // Colors absent from every guess cannot change any feedback
+    if (nb_irrelevant_colors != 0 && is_feasible(remaining)) {
+        count = saturating_add(count, saturating_multiply(nb_irrelevant_colors, count_from(position + 1)));
+    }
+
+    position_memo.emplace(std::move(key), count);
+    return count;
+}
+
+
+const std::vector<std::uint64_t>& Counter::partition_from(size_t position) {
+    if (position == pegs) {
+        return is_consistent() ? consistent_leaf : inconsistent_leaf;
+    }
+
+    auto key = make_key();
+    auto& position_memo = partition_memo[position];
+    if (const auto it = position_memo.find(key); it != position_memo.end()) {
+        return it->second;
+    }
+
+    // Histogram of the black and black + white pegs the suffix adds to the probed guess
+    const size_t stride = pegs + 1;
+    const size_t remaining = pegs - position - 1;
+    std::vector<std::uint64_t> histogram(stride * stride, 0);
+    for (Color color : relevant_colors) {
+        const size_t black = probe[position] == color;
+        const size_t total = counts[color] < probe_counts[color];
+        place(color, position);
+        if (is_feasible(remaining)) {
+            const auto& child = partition_from(position + 1);
+            for (size_t b = 0; b + black <= pegs; ++b) {
+                for (size_t t = 0; t + total <= pegs; ++t) {
+                    auto& nb_codes = histogram[(b + black) * stride + t + total];
+                    nb_codes = saturating_add(nb_codes, child[b * stride + t]);
+                }
+            }
+        }
+        unplace(color, position);
+    }
+
+    // Colors absent from every guess cannot change any feedback
+    if (nb_irrelevant_colors != 0 && is_feasible(remaining)) {
+        const auto& child = partition_from(position + 1);
+        for (size_t i = 0; i < histogram.size(); ++i) {
+            histogram[i] = saturating_add(histogram[i], saturating_multiply(nb_irrelevant_colors, child[i]));
+        }
+    }
+
+    return position_memo.emplace(std::move(key), std::move(histogram)).first->second;
+}
+
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <span>
+#include <vector>
+
+#include "Code.h"
+#include "DuplicateSolver.h"
+#include "Feedback.h"
+
+
+namespace duplicate {
+
+// Counter: counts the codes consistent with a set of (guess, feedback) constraints
+// without enumerating them. Memoization is done per position on the black pegs
+// of every constraint and on the color counts, capped to what any guess can use.
+class Counter {
+    struct Constraint {
+        Code guess;
+        std::vector<std::uint8_t> guess_counts;
+        std::uint8_t black;
+        std::uint8_t total;
+    };
+
+    const std::uint8_t pegs;
+    const std::uint8_t colors;
+    std::vector<Constraint> constraints;
+    std::vector<Color> relevant_colors;
+    std::vector<std::uint8_t> caps;
+    std::uint8_t nb_irrelevant_colors;
+
+    std::vector<std::uint8_t> blacks;
+    std::vector<std::uint8_t> totals;
+    std::vector<std::uint8_t> counts;
+    std::vector<std::map<std::vector<std::uint8_t>, std::uint64_t>> memo;
+
+    Code probe;
+    std::vector<std::uint8_t> probe_counts;
+    std::vector<std::uint64_t> consistent_leaf;
+    std::vector<std::uint64_t> inconsistent_leaf;
+    std::vector<std::map<std::vector<std::uint8_t>, std::vector<std::uint64_t>>> partition_memo;
+
+public:
+    Counter(std::uint8_t pegs, std::uint8_t colors);
+
+    void add_constraint(const Code& guess, const FrequencyMap& guess_frequency_map, const Feedback& feedback);
+
+    // Exact number of consistent codes, saturated at the largest std::uint64_t
+    std::uint64_t count();
+
+    // Knuth's random probe estimate of the number of consistent codes, for boards too large to count
+    double estimate(unsigned int nb_probes, unsigned int seed);
+
+    // Number of consistent codes giving each feedback to the guess, indexed by black * (pegs + 1) + white, saturated as count
+    std::vector<std::uint64_t> partition(const Code& guess, const FrequencyMap& guess_frequency_map);
+
+private:
+    void prepare(std::span<const std::uint8_t> extra_counts = {});
+
+    void place(Color color, size_t position);
+    void unplace(Color color, size_t position);
+    bool is_feasible(size_t remaining) const;
+    bool is_consistent() const;
+
+    std::vector<std::uint8_t> make_key() const;
+    std::uint64_t count_from(size_t position);
+    const std::vector<std::uint64_t>& partition_from(size_t position);
+};
+
+}
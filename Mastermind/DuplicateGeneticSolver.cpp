@@ -0,0 +1,227 @@
+#include "DuplicateGeneticSolver.h"
+#include "PartitionScore.h"
+#include "Trace.h"
+#include <algorithm>
+#include <chrono>
+// With GCC the parallel algorithms run on TBB, link with -ltbb
+#include <execution>
+#include <limits>
+#include <numeric>
+
+
+namespace duplicate {
+
+namespace {
+
+// Breeding odds, in percent
+constexpr unsigned int elite_rate = 10;
+constexpr unsigned int two_point_crossover_rate = 50;
+constexpr unsigned int mutation_rate = 3;
+constexpr unsigned int permutation_rate = 3;
+constexpr unsigned int inversion_rate = 2;
+
+}
+
+GeneticSolver::GeneticSolver(std::uint8_t pegs, std::uint8_t colors, const GeneticSettings& settings)
+    : pegs(pegs)
+    , colors(colors)
+    , settings(settings)
+    , population(settings.population_size, History{ Code(ceil_to_multiple_of(pegs, 16), 0), FrequencyMap(colors) })
+    , offspring(population)
+    , fitness(settings.population_size, 0)
+    , ranking(settings.population_size, 0)
+    , rng(settings.seed)
+    , guess(ceil_to_multiple_of(pegs, 16), 0)
+    , guess_frequency_map(colors)
+    , feedback_calculator(pegs, colors)
+    , game_trace(nullptr)
+    , exhausted(false)
+{
+    for (auto& individual : population) {
+        randomize(individual);
+    }
+    eligible.reserve(settings.max_eligible);
+}
+
+void GeneticSolver::set_game_trace(GameTrace* game_trace) {
+    this->game_trace = game_trace;
+}
+
+FeedbackCalculator& GeneticSolver::get_feedback_calculator() {
+    return feedback_calculator;
+}
+
+std::tuple<const Code&, const FrequencyMap&> GeneticSolver::next_guess() {
+    TRACE_SCOPE("next_guess");
+    if (exhausted) {
+        clear_guess();
+        return { guess, guess_frequency_map };
+    }
+
+    const auto deadline = std::chrono::steady_clock::now() + settings.budget;
+
+    evaluate();
+    for (unsigned int generation = 0; generation < settings.max_generations && eligible.size() < settings.max_eligible; ++generation) {
+        // At least one generation so that a first eligible code has a chance to show up
+        if (generation != 0 && std::chrono::steady_clock::now() >= deadline) {
+            break;
+        }
+
+        breed();
+        evaluate();
+    }
+
+    // Eligible codes are consistent with the history so never played yet, the fittest one of the population may have been
+    if (eligible.empty()) {
+        std::iota(ranking.begin(), ranking.end(), size_t{ 0 });
+        std::ranges::stable_sort(ranking, {}, [&](size_t i) { return fitness[i]; });
+        const auto fittest = std::ranges::find_if(ranking, [&](size_t i) { return !is_played(population[i].get_code()); });
+        if (fittest == ranking.end()) {
+            exhausted = true;
+            clear_guess();
+            return { guess, guess_frequency_map };
+        }
+
+        const History& individual = population[*fittest];
+        guess = individual.get_code();
+        guess_frequency_map = individual.get_frequency_map();
+        return { guess, guess_frequency_map };
+    }
+
+    std::uint64_t best_score = std::numeric_limits<std::uint64_t>::max();
+    const History* best = nullptr;
+    for (const auto& candidate : eligible) {
+        const std::uint64_t score = partition_score(candidate, eligible, pegs, colors, partition_sizes);
+        if (score < best_score) {
+            best_score = score;
+            best = &candidate;
+        }
+    }
+
+    guess = best->get_code();
+    guess_frequency_map = best->get_frequency_map();
+    return { guess, guess_frequency_map };
+}
+
+void GeneticSolver::apply_feedback(const Feedback& feedback) {
+    TRACE_SCOPE("apply_feedback");
+    if (game_trace) {
+        game_trace->add_move(guess, feedback);
+    }
+
+    const std::uint8_t black = static_cast<std::uint8_t>(feedback.black());
+    const std::uint8_t total = static_cast<std::uint8_t>(feedback.black() + feedback.white());
+    constraints.emplace_back(History{ guess, guess_frequency_map }, black, total);
+
+    // No code gets more pegs than the board, more black than matching pegs, or all of its pegs but one black
+    if (total > pegs || black > total || (black + 1 == pegs && total == pegs) || constraints.size() >= settings.max_guesses) {
+        exhausted = true;
+    }
+
+    // The eligible codes still consistent stay eligible, the population carries over as it is
+    std::erase_if(eligible, [&](const History& individual) {
+        const std::uint8_t code_black = count_black_pegs(individual.get_code(), guess, pegs - 1);
+        const std::uint8_t code_total = compare_and_count(individual.get_frequency_map(), guess_frequency_map, colors);
+        return code_black != black || code_total != total;
+    });
+}
+
+bool GeneticSolver::can_continue() const {
+    return !exhausted;
+}
+
+bool GeneticSolver::is_played(const Code& code) const {
+    return std::ranges::any_of(constraints, [&](const Constraint& constraint) {
+        return std::equal(code.begin(), code.begin() + pegs, constraint.guess.get_code().begin());
+    });
+}
+
+void GeneticSolver::clear_guess() {
+    std::ranges::fill(guess, 0);
+    std::ranges::fill(guess_frequency_map, 0);
+}
+
+void GeneticSolver::evaluate() {
+    std::transform(std::execution::par, population.begin(), population.end(), fitness.begin(),
+        [this](const History& individual) { return get_fitness(individual); });
+
+    for (size_t i = 0; i < population.size() && eligible.size() < settings.max_eligible; ++i) {
+        if (fitness[i] == 0 && std::ranges::none_of(eligible, [&](const History& code) { return code.get_code() == population[i].get_code(); })) {
+            eligible.push_back(population[i]);
+        }
+    }
+}
+
+void GeneticSolver::breed() {
+    std::iota(ranking.begin(), ranking.end(), size_t{ 0 });
+    std::ranges::sort(ranking, {}, [&](size_t i) { return fitness[i]; });
+
+    // The fittest individuals go through unchanged
+    const size_t nb_elites = population.size() * elite_rate / 100;
+    for (size_t i = 0; i < nb_elites; ++i) {
+        offspring[i] = population[ranking[i]];
+    }
+
+    std::uniform_int_distribution<size_t> individual_distribution(0, population.size() - 1);
+    std::uniform_int_distribution<unsigned int> percent_distribution(0, 99);
+    std::uniform_int_distribution<size_t> position_distribution(0, pegs - 1);
+    std::uniform_int_distribution<unsigned int> color_distribution(0, colors - 1);
+    const auto select = [&]() -> const History& {
+        // Binary tournament
+        const size_t lhs = individual_distribution(rng);
+        const size_t rhs = individual_distribution(rng);
+        return population[fitness[lhs] <= fitness[rhs] ? lhs : rhs];
+    };
+
+    for (size_t i = nb_elites; i < offspring.size(); ++i) {
+        const Code& father = select().get_code();
+        const Code& mother = select().get_code();
+        Code& child = offspring[i].get_code();
+
+        size_t first = position_distribution(rng);
+        size_t last = percent_distribution(rng) < two_point_crossover_rate ? position_distribution(rng) : pegs - 1;
+        if (first > last) {
+            std::swap(first, last);
+        }
+        for (size_t j = 0; j < pegs; ++j) {
+            child[j] = (j >= first && j <= last) ? mother[j] : father[j];
+        }
+
+        if (percent_distribution(rng) < mutation_rate) {
+            child[position_distribution(rng)] = static_cast<Color>(color_distribution(rng));
+        }
+        if (percent_distribution(rng) < permutation_rate) {
+            std::swap(child[position_distribution(rng)], child[position_distribution(rng)]);
+        }
+        if (percent_distribution(rng) < inversion_rate) {
+            size_t begin = position_distribution(rng);
+            size_t end = position_distribution(rng);
+            if (begin > end) {
+                std::swap(begin, end);
+            }
+            std::reverse(child.begin() + begin, child.begin() + end + 1);
+        }
+
+        recount(offspring[i]);
+    }
+
+    std::swap(population, offspring);
+}
+
+void GeneticSolver::randomize(History& individual) {
+    std::uniform_int_distribution<unsigned int> color_distribution(0, colors - 1);
+    for (size_t i = 0; i < pegs; ++i) {
+        individual.get_code()[i] = static_cast<Color>(color_distribution(rng));
+    }
+    recount(individual);
+}
+
+void GeneticSolver::recount(History& individual) const {
+    FrequencyMap& frequency_map = individual.get_frequency_map();
+    std::ranges::fill(frequency_map, 0);
+    for (size_t i = 0; i < pegs; ++i) {
+        ++frequency_map[individual.get_code()[i]];
+    }
+}
+
+}
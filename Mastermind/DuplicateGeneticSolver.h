@@ -0,0 +1,96 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <tuple>
+#include <vector>
+
+#include "Code.h"
+#include "DuplicateSolver.h"
+#include "Feedback.h"
+#include "GameTrace.h"
+
+
+namespace duplicate {
+
+struct GeneticSettings {
+    unsigned int population_size = 150;
+    unsigned int max_generations = 100;                                     // Per move
+    unsigned int max_eligible = 60;                                         // Consistent codes gathered before choosing the guess
+    std::chrono::steady_clock::duration budget = std::chrono::milliseconds(50); // Per move, checked between generations
+    unsigned int seed = 0;
+    unsigned int max_guesses = 100;                                         // Per game, the game is given up past it
+};
+
+// GeneticSolver: for boards where even a single consistent code takes too long to find by backtracking.
+// A population of codes evolves toward consistency with the history; the fitness of a code is how far its
+// feedbacks to the old guesses are from the actual ones, evaluated in parallel over the population. The
+// consistent codes met on the way are eligible, the one splitting the others best is played. With none
+// after a bounded number of generations, the fittest code not played yet is played instead.
+class GeneticSolver {
+    struct Constraint {
+        History guess;
+        std::uint8_t black;
+        std::uint8_t total;
+    };
+
+    const std::uint8_t pegs;
+    const std::uint8_t colors;
+    const GeneticSettings settings;
+    std::vector<Constraint> constraints;
+    std::vector<History> population;
+    std::vector<History> offspring;
+    std::vector<unsigned int> fitness;
+    std::vector<size_t> ranking;
+    std::vector<History> eligible;
+    std::vector<std::uint32_t> partition_sizes;
+    std::mt19937 rng;
+    Code guess;
+    FrequencyMap guess_frequency_map;
+    FeedbackCalculator feedback_calculator;
+    GameTrace* game_trace;
+    bool exhausted;
+
+public:
+    GeneticSolver(std::uint8_t pegs, std::uint8_t colors, const GeneticSettings& settings = {});
+
+    // Records every guess and its feedback in the trace, pass nullptr to stop recording
+    void set_game_trace(GameTrace* game_trace);
+
+    FeedbackCalculator& get_feedback_calculator();
+
+    // Once can_continue() is false the guess, cleared, is not to be played
+    std::tuple<const Code&, const FrequencyMap&> next_guess();
+
+    void apply_feedback(const Feedback& feedback);
+
+    // The population never runs out, the game stops once a feedback no code can give was applied, at the guess limit
+    // or when every code of the population was played already
+    bool can_continue() const;
+
+private:
+    bool is_played(const Code& code) const;
+
+    // Leaves no guess already played to return once the solver is exhausted
+    void clear_guess();
+
+    void evaluate();
+    void breed();
+    void randomize(History& individual);
+    void recount(History& individual) const;
+
+    // 0 for a code consistent with the whole history
+    inline unsigned int get_fitness(const History& individual) const {
+        unsigned int distance = 0;
+        for (const auto& [old_guess, black, total] : constraints) {
+            const std::uint8_t code_black = count_black_pegs(individual.get_code(), old_guess.get_code(), pegs - 1);
+            const std::uint8_t code_total = compare_and_count(individual.get_frequency_map(), old_guess.get_frequency_map(), colors);
+            distance += (code_black > black ? code_black - black : black - code_black)
+                + (code_total > total ? code_total - total : total - code_total);
+        }
+        return distance;
+    }
+};
+
+}
@@ -0,0 +1,160 @@
+#include "DuplicateMonteCarloSolver.h"
+#include "PartitionScore.h"
+#include "Trace.h"
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+
+namespace duplicate {
+
+MonteCarloSolver::MonteCarloSolver(std::uint8_t pegs, std::uint8_t colors, const MonteCarloSettings& settings)
+    : pegs(pegs)
+    , colors(colors)
+    , last_position(pegs - 1)
+    , settings(settings)
+    , color_orders(pegs, std::vector<Color>(colors))
+    , slots(pegs, 0)
+    , code(ceil_to_multiple_of(pegs, 16), 0)
+    , code_frequency_map(colors)
+    , rng(settings.seed)
+    , guess(ceil_to_multiple_of(pegs, 16), 0)
+    , guess_frequency_map(colors)
+    , exhausted(false)
+    , feedback_calculator(pegs, colors)
+    , game_trace(nullptr)
+{
+    for (auto& color_order : color_orders) {
+        std::iota(color_order.begin(), color_order.end(), Color{ 0 });
+    }
+    sample.reserve(settings.sample_size);
+}
+
+void MonteCarloSolver::set_game_trace(GameTrace* game_trace) {
+    this->game_trace = game_trace;
+}
+
+FeedbackCalculator& MonteCarloSolver::get_feedback_calculator() {
+    return feedback_calculator;
+}
+
+std::tuple<const Code&, const FrequencyMap&> MonteCarloSolver::next_guess() {
+    TRACE_SCOPE("next_guess");
+    if (exhausted) {
+        return { guess, guess_frequency_map };
+    }
+
+    SearchBudget budget(settings.budget);
+    fill_sample(budget);
+    if (sample.empty()) {
+        // The guess is cleared rather than left as the one already played
+        exhausted = true;
+        std::ranges::fill(guess, 0);
+        std::ranges::fill(guess_frequency_map, 0);
+        return { guess, guess_frequency_map };
+    }
+
+    // Expected size of the consistent set after the guess, up to the sample size
+    std::uint64_t best_score = std::numeric_limits<std::uint64_t>::max();
+    const History* best = nullptr;
+    for (const auto& candidate : sample) {
+        const std::uint64_t score = partition_score(candidate, sample, pegs, colors, partition_sizes);
+        if (score < best_score) {
+            best_score = score;
+            best = &candidate;
+        }
+    }
+
+    guess = best->get_code();
+    guess_frequency_map = best->get_frequency_map();
+    return { guess, guess_frequency_map };
+}
+
+void MonteCarloSolver::apply_feedback(const Feedback& feedback) {
+    TRACE_SCOPE("apply_feedback");
+    if (game_trace) {
+        game_trace->add_move(guess, feedback);
+    }
+
+    const std::uint8_t black = static_cast<std::uint8_t>(feedback.black());
+    const std::uint8_t total = static_cast<std::uint8_t>(feedback.black() + feedback.white());
+    constraints.emplace_back(History{ guess, guess_frequency_map }, black, total);
+
+    // The sampled codes still consistent stay in the sample of the next move
+    std::erase_if(sample, [&](const History& code_sample) {
+        const std::uint8_t code_black = count_black_pegs(code_sample.get_code(), guess, last_position);
+        const std::uint8_t code_total = compare_and_count(code_sample.get_frequency_map(), guess_frequency_map, colors);
+        return code_black != black || code_total != total;
+    });
+}
+
+bool MonteCarloSolver::can_continue() const {
+    return !exhausted;
+}
+
+void MonteCarloSolver::fill_sample(SearchBudget& budget) {
+    // Restarts stop once they mostly find codes already sampled, the consistent set is then about the sample
+    const unsigned int max_nb_restarts = 4 * settings.sample_size;
+    for (unsigned int restart = 0; sample.size() < settings.sample_size && restart < max_nb_restarts; ++restart) {
+        // The first code is searched for without limit so that there is always a guess to play
+        SearchBudget unbounded;
+        const auto state = sample_code(sample.empty() ? unbounded : budget);
+        if (!state) {
+            sample.clear();
+            return;
+        }
+        if (*state == SearchState::interrupted) {
+            return;
+        }
+
+        const bool already_sampled = std::ranges::any_of(sample, [&](const History& code_sample) {
+            return std::equal(code.begin(), code.begin() + pegs, code_sample.get_code().begin());
+        });
+        if (!already_sampled) {
+            sample.emplace_back(code, code_frequency_map);
+        }
+    }
+}
+
+std::optional<SearchState> MonteCarloSolver::sample_code(SearchBudget& budget) {
+    std::ranges::fill(code_frequency_map, 0);
+    size_t position = 0;
+    std::ranges::shuffle(color_orders[0], rng);
+    slots[0] = 0;
+
+    while (true) {
+        if (budget.is_expired()) {
+            return SearchState::interrupted;
+        }
+
+        if (slots[position] == colors) {
+            if (position == 0u) {
+                return std::nullopt;
+            }
+
+            --code_frequency_map[code[--position]];
+            ++slots[position];
+            continue;
+        }
+
+        const Color color = color_orders[position][slots[position]];
+        code[position] = color;
+        ++code_frequency_map[color];
+
+        if (is_feasible(position)) {
+            if (position == last_position) {
+                return SearchState::found;
+            }
+
+            ++position;
+            std::ranges::shuffle(color_orders[position], rng);
+            slots[position] = 0;
+            continue;
+        }
+
+        --code_frequency_map[color];
+        ++slots[position];
+    }
+}
+
+}
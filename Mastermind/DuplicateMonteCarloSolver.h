@@ -0,0 +1,92 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <tuple>
+#include <vector>
+
+#include "Code.h"
+#include "DuplicateSolver.h"
+#include "Feedback.h"
+#include "GameTrace.h"
+#include "SearchBudget.h"
+
+
+namespace duplicate {
+
+struct MonteCarloSettings {
+    unsigned int sample_size = 256;                                         // Consistent codes sampled per move, also the candidate guesses
+    std::chrono::steady_clock::duration budget = std::chrono::milliseconds(50); // Sampling time per move, at least one code is always sampled
+    unsigned int seed = 0;
+};
+
+// MonteCarloSolver: for boards whose consistent set cannot be enumerated. Each move samples consistent
+// codes with randomized restarts of the depth first search, then plays the sampled code whose feedbacks
+// split the sample into the smallest partitions, by the sum of the squared partition sizes.
+class MonteCarloSolver {
+    struct Constraint {
+        History guess;
+        std::uint8_t black;
+        std::uint8_t total;
+    };
+
+    const std::uint8_t pegs;
+    const std::uint8_t colors;
+    const size_t last_position;
+    const MonteCarloSettings settings;
+    std::vector<Constraint> constraints;
+    std::vector<History> sample;
+    std::vector<std::vector<Color>> color_orders;
+    std::vector<std::uint8_t> slots;
+    alignas(std::hardware_destructive_interference_size) Code code;
+    FrequencyMap code_frequency_map;
+    std::vector<std::uint32_t> partition_sizes;
+    std::mt19937 rng;
+    Code guess;
+    FrequencyMap guess_frequency_map;
+    bool exhausted;
+    FeedbackCalculator feedback_calculator;
+    GameTrace* game_trace;
+
+public:
+    MonteCarloSolver(std::uint8_t pegs, std::uint8_t colors, const MonteCarloSettings& settings = {});
+
+    // Records every guess and its feedback in the trace, pass nullptr to stop recording
+    void set_game_trace(GameTrace* game_trace);
+
+    FeedbackCalculator& get_feedback_calculator();
+
+    // Sampled codes are consistent with the history, so a code already played is never guessed again. Once no code
+    // is left can_continue() turns false and the guess, cleared, is not to be played.
+    std::tuple<const Code&, const FrequencyMap&> next_guess();
+
+    void apply_feedback(const Feedback& feedback);
+
+    bool can_continue() const;
+
+private:
+    void fill_sample(SearchBudget& budget);
+
+    // Randomized depth first search for one consistent code, nullopt if there is none
+    std::optional<SearchState> sample_code(SearchBudget& budget);
+
+    inline bool is_feasible(size_t position) const {
+        const size_t left = last_position - position;
+        for (const auto& [old_guess, black, total] : constraints) {
+            const std::uint8_t code_black = count_black_pegs(code, old_guess.get_code(), position);
+            if (code_black > black || code_black + left < black) {
+                return false;
+            }
+
+            const std::uint8_t code_total = compare_and_count(code_frequency_map, old_guess.get_frequency_map(), colors);
+            if (code_total > total || code_total + left < total) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+}
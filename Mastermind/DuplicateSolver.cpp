@@ -1,10 +1,30 @@
 #include "DuplicateSolver.h"
+#include "DuplicateCounter.h"
+#include "Serialization.h"
+#include "Trace.h"
 #include <algorithm>
+#include <array>
 #include <ranges>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
 
 
 namespace duplicate {
 
+namespace {
+
+constexpr std::array<char, 4> checkpoint_magic{ 'M', 'M', 'C', 'D' };
+constexpr std::uint8_t checkpoint_version = 1;
+// Far above the guesses of any game, bounds the history read back from a checkpoint
+constexpr std::uint32_t max_history_size = 1 << 16;
+
+std::generator<SearchState> exhausted_search() {
+    co_return;
+}
+
+}
+
 std::uint8_t ceil_to_multiple_of(std::uint8_t nb_bins, std::uint8_t multiple)
 {
     return ((nb_bins - 1) / 16 + 1) * 16;
@@ -21,7 +41,7 @@ FeedbackCalculator::FeedbackCalculator(std::uint8_t pegs, std::uint8_t colors)
     : pegs(pegs)
     , colors(colors)
     , secret_frequency_map(colors)
-    , secret(ceil_to_multiple_of(colors, 16), 0)
+    , secret(ceil_to_multiple_of(pegs, 16), 0)
 {}
 
 FeedbackCalculator::FeedbackCalculator(std::uint8_t pegs, std::uint8_t colors, const Code& secret)
@@ -31,7 +51,7 @@ FeedbackCalculator::FeedbackCalculator(std::uint8_t pegs, std::uint8_t colors, c
 
 
 void FeedbackCalculator::set_secret(const Code& secret) {
-    std::ranges::copy(secret, this->secret.begin());
+    std::ranges::copy_n(secret.begin(), pegs, this->secret.begin());
 
     // Reset secret frequency map and compute it
     std::ranges::fill(secret_frequency_map, 0);
@@ -48,62 +68,377 @@ Feedback FeedbackCalculator::get_feedback(const Code& guess, const FrequencyMap&
 }
 
 
-Solver::Solver(std::uint8_t pegs, std::uint8_t colors)
+Solver::Solver(std::uint8_t pegs, std::uint8_t colors, SearchEngine search_engine)
     : pegs(pegs)
     , colors(colors)
+    , check_orders(pegs)
     , code(ceil_to_multiple_of(pegs, 16), 0)
     , code_frequency_map(colors)
-    , converted_code(ceil_to_multiple_of(pegs, 16), 0)
-    , converted_code_frequency_map(colors)
     , position(0)
     , last_position(pegs - 1)
     , all_colors_known_mode(false)
-    , color_map(colors)
-    , code_gen(backtrack())
+    , permutation_engine(pegs)
+    , search_engine(search_engine)
+    , multiset_pegs_left(colors + 1, 0)
+    , multiset_code(pegs, 0)
+    , multiset_color(0)
+    , arranging_multiset(false)
+    , code_gen(search_engine == SearchEngine::two_level ? backtrack_multisets() : backtrack())
     , code_it(code_gen.begin())
+    , search_pending(true)
+    , partial_guess_played(false)
+    , partial_code_frequency_map(colors)
+    , partial_code(ceil_to_multiple_of(pegs, 16), 0)
     , feedback_calculator(pegs, colors)
-{}
+    , game_trace(nullptr)
+{
+    // The first multiset has every peg of the first color
+    if (search_engine == SearchEngine::two_level) {
+        multiset_pegs_left[0] = pegs;
+        code_frequency_map[0] = pegs;
+    }
+}
+
+Solver::Solver(std::uint8_t pegs, std::uint8_t colors, std::span<const GameTrace::Move> moves, SearchEngine search_engine)
+    : Solver(pegs, colors, search_engine) {
+    Code guess(ceil_to_multiple_of(pegs, 16), 0);
+    FrequencyMap guess_frequency_map(colors);
+    for (const auto& [move_guess, feedback, checkpoint] : moves) {
+        std::ranges::copy(move_guess, guess.begin());
+        std::ranges::fill(guess_frequency_map, 0);
+        for (Color color : move_guess) {
+            ++guess_frequency_map[color];
+        }
+        add_to_history(guess, guess_frequency_map, feedback);
+    }
+}
+
+void Solver::set_game_trace(GameTrace* game_trace) {
+    this->game_trace = game_trace;
+}
 
 FeedbackCalculator& Solver::get_feedback_calculator() {
     return feedback_calculator;
 }
 
 std::tuple<const Code&, const FrequencyMap&> Solver::next_guess() {
-    if (all_colors_known_mode) {
-        std::ranges::fill(converted_code_frequency_map, 0);
-
-        for (size_t i = 0; i < pegs; ++i) {
-            const Color converted_color = color_map[code[i]];
-            converted_code[i] = converted_color;
-            ++converted_code_frequency_map[converted_color];
-        }
+    TRACE_SCOPE("next_guess");
+    resume_search(SearchBudget{});
+    partial_guess_played = false;
+    return { code, code_frequency_map };
+}
 
-        return { converted_code, converted_code_frequency_map };
+std::tuple<const Code&, const FrequencyMap&, GuessQuality> Solver::next_guess(const SearchBudget& search_budget) {
+    TRACE_SCOPE("next_guess");
+    const auto search_state = resume_search(search_budget);
+    if (!search_state) {
+        partial_guess_played = false;
+        return { code, code_frequency_map, GuessQuality::no_candidate };
     }
-    else {
-        return { code, code_frequency_map };
+    if (*search_state == SearchState::found) {
+        partial_guess_played = false;
+        return { code, code_frequency_map, GuessQuality::consistent };
     }
+
+    make_partial_guess();
+    partial_guess_played = true;
+    return { partial_code, partial_code_frequency_map, GuessQuality::partial };
 }
 
 void Solver::apply_feedback(const Feedback& feedback) {
-    history.emplace(feedback, History{ code, code_frequency_map });
+    TRACE_SCOPE("apply_feedback");
+    const Code& guess = partial_guess_played ? partial_code : code;
+    const FrequencyMap& guess_frequency_map = partial_guess_played ? partial_code_frequency_map : code_frequency_map;
+    partial_guess_played = false;
+
+    if (game_trace) {
+        game_trace->add_move(guess, feedback);
+    }
+
+    add_to_history(guess, guess_frequency_map, feedback);
 
+    // The replay resumes the search from here, as the game did
+    if (game_trace) {
+        std::ostringstream checkpoint(std::ios::binary);
+        save(checkpoint);
+        game_trace->set_checkpoint(std::move(checkpoint).str());
+    }
+}
+
+void Solver::add_to_history(const Code& guess, const FrequencyMap& guess_frequency_map, const Feedback& feedback) {
+    const auto& entry = *history.emplace(feedback, History{ guess, guess_frequency_map });
+    for (auto& check_order : check_orders) {
+        check_order.add(entry);
+    }
+
+    // The two level search arranges its multisets with the permutation engine too
+    if (all_colors_known_mode || search_engine == SearchEngine::two_level) {
+        permutation_engine.add_constraint(guess, static_cast<std::uint8_t>(feedback.black()));
+    }
     // Check if we should switch to permutation mode
     if (!all_colors_known_mode && feedback.black() + feedback.white() == pegs) {
+        TRACE_INSTANT("all_colors_known_mode");
         all_colors_known_mode = true;
-        code_gen = backtrack_using_only_code_colors();
+        permutation_engine.reset(guess);
+        for (const auto& [old_guess_feedback, data] : history) {
+            const auto& [old_guess, old_guess_frequency_map] = data;
+            permutation_engine.add_constraint(old_guess, static_cast<std::uint8_t>(old_guess_feedback.black()));
+        }
+
+        // The frequency map is the one of the known colors and stays so for every arrangement
+        code_frequency_map = guess_frequency_map;
+        code_gen = backtrack_permutations();
         code_it = code_gen.begin();
-        return;
     }
 
-    ++code_it;
+    search_pending = true;
 }
 
 bool Solver::can_continue() const {
     return code_it != code_gen.end();
 }
 
-std::generator<Solver::NewValue> Solver::backtrack() {
+std::uint64_t Solver::count_consistent() const {
+    return make_counter().count();
+}
+
+double Solver::estimate_consistent(unsigned int nb_probes, unsigned int seed) const {
+    return make_counter().estimate(nb_probes, seed);
+}
+
+Counter Solver::make_counter() const {
+    Counter counter(pegs, colors);
+    for (const auto& [old_guess_feedback, data] : history) {
+        const auto& [old_guess, old_guess_frequency_map] = data;
+        counter.add_constraint(old_guess, old_guess_frequency_map, old_guess_feedback);
+    }
+    return counter;
+}
+
+const std::vector<Solver::HistoryCheck>& Solver::get_check_order(size_t position) const {
+    return check_orders[position].get_checks();
+}
+
+void Solver::save(std::ostream& stream) const {
+    stream.write(checkpoint_magic.data(), checkpoint_magic.size());
+    write_value<std::uint8_t>(stream, checkpoint_version);
+    write_value<std::uint8_t>(stream, pegs);
+    write_value<std::uint8_t>(stream, colors);
+    write_value<std::uint8_t>(stream, static_cast<std::uint8_t>(search_engine));
+
+    // History in the order of the multimap, the check orders refer to the entries by their index in it
+    write_value<std::uint32_t>(stream, static_cast<std::uint32_t>(history.size()));
+    for (const auto& [old_guess_feedback, data] : history) {
+        const auto& [old_guess, old_guess_frequency_map] = data;
+        stream.write(reinterpret_cast<const char*>(old_guess.data()), pegs);
+        write_value<std::uint8_t>(stream, static_cast<std::uint8_t>(old_guess_feedback.black()));
+        write_value<std::uint8_t>(stream, static_cast<std::uint8_t>(old_guess_feedback.white()));
+    }
+
+    for (const auto& check_order : check_orders) {
+        write_value<std::uint64_t>(stream, check_order.get_nb_nodes_until_reorder());
+        for (const auto& [entry, nb_checks, nb_rejections] : check_order.get_checks()) {
+            const auto it = std::ranges::find_if(history, [&](const auto& h) { return &h == entry; });
+            write_value<std::uint32_t>(stream, static_cast<std::uint32_t>(std::ranges::distance(history.begin(), it)));
+            write_value<std::uint64_t>(stream, nb_checks);
+            write_value<std::uint64_t>(stream, nb_rejections);
+        }
+    }
+
+    // Search state, the peg stack is the code up to the position
+    stream.write(reinterpret_cast<const char*>(code.data()), pegs);
+    stream.write(reinterpret_cast<const char*>(&code_frequency_map[0]), colors);
+    write_value<std::uint32_t>(stream, static_cast<std::uint32_t>(position));
+    write_value<bool>(stream, all_colors_known_mode);
+    write_value<bool>(stream, search_pending);
+    write_value<bool>(stream, code_it == code_gen.end());
+    write_value<bool>(stream, partial_guess_played);
+    stream.write(reinterpret_cast<const char*>(partial_code.data()), pegs);
+    stream.write(reinterpret_cast<const char*>(&partial_code_frequency_map[0]), colors);
+    permutation_engine.save(stream);
+    write_vector(stream, multiset_pegs_left);
+    write_value<std::uint32_t>(stream, static_cast<std::uint32_t>(multiset_color));
+    write_value<bool>(stream, arranging_multiset);
+}
+
+void Solver::load(std::istream& stream) {
+    std::array<char, 4> magic{};
+    stream.read(magic.data(), magic.size());
+    if (!stream || magic != checkpoint_magic || read_value<std::uint8_t>(stream) != checkpoint_version) {
+        throw std::runtime_error("Not a checkpoint of a duplicate solver");
+    }
+    if (read_value<std::uint8_t>(stream) != pegs || read_value<std::uint8_t>(stream) != colors
+        || read_value<std::uint8_t>(stream) != static_cast<std::uint8_t>(search_engine)) {
+        throw std::runtime_error("Checkpoint saved with other pegs, colors or search engine");
+    }
+
+    // Everything is read into locals and checked first, the solver is only changed once the whole checkpoint is valid
+    const auto history_size = read_value<std::uint32_t>(stream);
+    if (!stream || history_size > max_history_size) {
+        throw std::runtime_error("Truncated or corrupted checkpoint");
+    }
+    decltype(history) loaded_history;
+    std::vector<const HistoryEntry*> entries(history_size);
+    Code guess(ceil_to_multiple_of(pegs, 16), 0);
+    FrequencyMap guess_frequency_map(colors);
+    for (auto& entry : entries) {
+        stream.read(reinterpret_cast<char*>(guess.data()), pegs);
+        const auto black = read_value<std::uint8_t>(stream);
+        const auto white = read_value<std::uint8_t>(stream);
+        if (black + white > pegs) {
+            throw std::runtime_error("Corrupted checkpoint");
+        }
+        std::ranges::fill(guess_frequency_map, 0);
+        for (size_t i = 0; i < pegs; ++i) {
+            if (guess[i] >= colors) {
+                throw std::runtime_error("Corrupted checkpoint");
+            }
+            ++guess_frequency_map[guess[i]];
+        }
+        entry = &*loaded_history.emplace(Feedback{ black, white }, History{ guess, guess_frequency_map });
+    }
+
+    // Each position checks every entry once, an entry left out would let inconsistent codes through
+    std::vector<std::uint64_t> nb_nodes_until_reorder(check_orders.size());
+    std::vector<std::vector<HistoryCheck>> loaded_checks(check_orders.size(), std::vector<HistoryCheck>(entries.size()));
+    for (size_t i = 0; i < check_orders.size(); ++i) {
+        nb_nodes_until_reorder[i] = read_value<std::uint64_t>(stream);
+        std::vector<bool> is_checked(entries.size(), false);
+        for (auto& [entry, nb_checks, nb_rejections] : loaded_checks[i]) {
+            const auto index = read_value<std::uint32_t>(stream);
+            if (index >= entries.size() || is_checked[index]) {
+                throw std::runtime_error("Corrupted checkpoint");
+            }
+            is_checked[index] = true;
+            entry = entries[index];
+            nb_checks = read_value<std::uint64_t>(stream);
+            nb_rejections = read_value<std::uint64_t>(stream);
+        }
+    }
+
+    Code loaded_code = code;
+    FrequencyMap loaded_code_frequency_map = code_frequency_map;
+    Code loaded_partial_code = partial_code;
+    FrequencyMap loaded_partial_code_frequency_map = partial_code_frequency_map;
+    PermutationEngine loaded_permutation_engine(pegs);
+    stream.read(reinterpret_cast<char*>(loaded_code.data()), pegs);
+    stream.read(reinterpret_cast<char*>(&loaded_code_frequency_map[0]), colors);
+    const size_t loaded_position = read_value<std::uint32_t>(stream);
+    const bool loaded_all_colors_known_mode = read_value<bool>(stream);
+    const bool loaded_search_pending = read_value<bool>(stream);
+    const bool exhausted = read_value<bool>(stream);
+    const bool loaded_partial_guess_played = read_value<bool>(stream);
+    stream.read(reinterpret_cast<char*>(loaded_partial_code.data()), pegs);
+    stream.read(reinterpret_cast<char*>(&loaded_partial_code_frequency_map[0]), colors);
+    loaded_permutation_engine.load(stream, colors);
+    auto loaded_multiset_pegs_left = read_vector<std::uint8_t>(stream, colors + 1u);
+    const size_t loaded_multiset_color = read_value<std::uint32_t>(stream);
+    const bool loaded_arranging_multiset = read_value<bool>(stream);
+
+    if (!stream || loaded_position > last_position || loaded_multiset_pegs_left.size() != colors + 1u || loaded_multiset_color >= colors) {
+        throw std::runtime_error("Truncated or corrupted checkpoint");
+    }
+
+    // The searches index the frequency maps with the colors of the codes. The pegs before the position
+    // are placed, the one at the position and the ones after it may be one past the last color.
+    // The frequency map of the partial code is only built along with a partial guess.
+    FrequencyMap partial_code_recount(colors);
+    for (size_t i = 0; i < pegs; ++i) {
+        if (loaded_code[i] > colors || (i < loaded_position && loaded_code[i] == colors) || loaded_partial_code[i] >= colors) {
+            throw std::runtime_error("Corrupted checkpoint");
+        }
+        ++partial_code_recount[loaded_partial_code[i]];
+    }
+    for (std::uint8_t color = 0; color < colors; ++color) {
+        if (loaded_code_frequency_map[color] > pegs
+            || (loaded_partial_guess_played && loaded_partial_code_frequency_map[color] != partial_code_recount[color])) {
+            throw std::runtime_error("Corrupted checkpoint");
+        }
+    }
+    if (std::ranges::any_of(loaded_multiset_pegs_left, [&](std::uint8_t pegs_left) { return pegs_left > pegs; })) {
+        throw std::runtime_error("Corrupted checkpoint");
+    }
+
+    // The multiset being built never has more pegs than the code, its arrangements are written in a code of the board
+    if (search_engine == SearchEngine::two_level && !loaded_all_colors_known_mode) {
+        bool valid_multiset = loaded_multiset_pegs_left[0] == pegs
+            && loaded_code_frequency_map[static_cast<std::uint8_t>(loaded_multiset_color)] <= loaded_multiset_pegs_left[loaded_multiset_color];
+        for (size_t color = 0; color < colors; ++color) {
+            const std::uint8_t nb_pegs = loaded_code_frequency_map[static_cast<std::uint8_t>(color)];
+            if (color < loaded_multiset_color) {
+                valid_multiset = valid_multiset && nb_pegs <= loaded_multiset_pegs_left[color]
+                    && loaded_multiset_pegs_left[color + 1] == loaded_multiset_pegs_left[color] - nb_pegs;
+            }
+            else if (color > loaded_multiset_color) {
+                valid_multiset = valid_multiset && nb_pegs == 0;
+            }
+        }
+        if (!valid_multiset) {
+            throw std::runtime_error("Corrupted checkpoint");
+        }
+    }
+
+    // The entries stay where they are when the histories are swapped, the checks keep pointing to them
+    history.swap(loaded_history);
+    for (size_t i = 0; i < check_orders.size(); ++i) {
+        check_orders[i].restore(std::move(loaded_checks[i]), nb_nodes_until_reorder[i]);
+    }
+    code = std::move(loaded_code);
+    code_frequency_map = std::move(loaded_code_frequency_map);
+    position = loaded_position;
+    all_colors_known_mode = loaded_all_colors_known_mode;
+    search_pending = loaded_search_pending;
+    partial_guess_played = loaded_partial_guess_played;
+    partial_code = std::move(loaded_partial_code);
+    partial_code_frequency_map = std::move(loaded_partial_code_frequency_map);
+    permutation_engine.swap(loaded_permutation_engine);
+    multiset_pegs_left = std::move(loaded_multiset_pegs_left);
+    multiset_color = loaded_multiset_color;
+    arranging_multiset = loaded_arranging_multiset;
+
+    // The search keeps all its state in the members, a new coroutine picks it up where the saved one stopped
+    code_gen = exhausted ? exhausted_search()
+        : all_colors_known_mode ? backtrack_permutations()
+        : search_engine == SearchEngine::two_level ? backtrack_multisets()
+        : backtrack();
+    code_it = code_gen.begin();
+}
+
+std::optional<SearchState> Solver::resume_search(const SearchBudget& search_budget) {
+    // A finished search is never resumed, later feedbacks cannot bring codes back
+    if (code_it == code_gen.end()) {
+        search_pending = false;
+        return std::nullopt;
+    }
+    if (!search_pending) {
+        return SearchState::found;
+    }
+
+    TRACE_SCOPE("backtrack_resume");
+    budget = search_budget;
+    ++code_it;
+    if (code_it == code_gen.end()) {
+        search_pending = false;
+        return std::nullopt;
+    }
+    if (*code_it == SearchState::interrupted) {
+        return SearchState::interrupted;
+    }
+
+    search_pending = false;
+    return SearchState::found;
+}
+
+std::generator<SearchState> Solver::backtrack() {
+    // Suspended until a guess is asked for, so that the whole search runs within next_guess
+    co_yield SearchState::interrupted;
+
+    // The frequency map counts the pegs placed before the position, the search may resume a checkpoint
+    std::ranges::fill(code_frequency_map, 0);
+    for (size_t i = 0; i < position; ++i) {
+        ++code_frequency_map[code[i]];
+    }
+
     while (true) {
         const Color color = code[position];
         if (color >= colors) {
@@ -111,26 +446,31 @@ std::generator<Solver::NewValue> Solver::backtrack() {
                 break;
             }
 
+            // Polled when backtracking only, the nodes in between are at most the colors of each position
+            if (budget.is_expired()) {
+                co_yield SearchState::interrupted;
+            }
+
             --code_frequency_map[code[--position]];
         }
         else {
             ++code_frequency_map[color];
 
             if (position == last_position) {
-                if (std::ranges::all_of(history, [&](const auto& h) {
+                if (check_orders[position].all_of([&](const auto& h) {
                     const auto& [old_guess_feedback, data] = h;
                     const auto& [old_guess, old_guess_frequency_map] = data;
                     return is_same_feedback(old_guess, old_guess_feedback, old_guess_frequency_map);
                     })) {
 
-                    co_yield{};
+                    co_yield SearchState::found;
                 }
 
                 --code_frequency_map[color];
             }
             else {
                 // Partial code pruning
-                if (std::ranges::all_of(history, [&](const auto& h) {
+                if (check_orders[position].all_of([&](const auto& h) {
                     const auto& [old_guess_feedback, data] = h;
                     const auto& [old_guess, old_guess_frequency_map] = data;
                     return is_similar_feedback(old_guess, old_guess_feedback, old_guess_frequency_map);
@@ -149,55 +489,147 @@ std::generator<Solver::NewValue> Solver::backtrack() {
     }
 }
 
-std::generator<Solver::NewValue> Solver::backtrack_using_only_code_colors() {
-    create_color_map();
-    convert_code_and_history();
+std::generator<SearchState> Solver::backtrack_permutations() {
+    // Suspended until a guess is asked for, so that the whole search runs within next_guess
+    co_yield SearchState::interrupted;
 
-    colors = pegs;
+    while (const auto state = permutation_engine.next(code, budget)) {
+        co_yield *state;
+    }
+}
 
-    // Free last color
-    --code_frequency_map[code[position]];
+std::generator<SearchState> Solver::backtrack_multisets() {
+    // Suspended until a guess is asked for, so that the whole search runs within next_guess
+    co_yield SearchState::interrupted;
 
-    return backtrack();
-}
+    // Depth first over the colors, from the most pegs of a color to none. The colors after
+    // the current one have no peg, the frequency map is the multiset being built.
+    while (true) {
+        if (arranging_multiset) {
+            // The feedbacks applied since the last arrangement may rule out the whole multiset
+            while (is_multiset_feasible(multiset_color, 0)) {
+                const auto state = permutation_engine.next(code, budget);
+                if (!state) {
+                    break;
+                }
+                co_yield *state;
+            }
+            arranging_multiset = false;
+        }
+        else {
+            if (budget.is_expired()) {
+                co_yield SearchState::interrupted;
+            }
 
-void Solver::create_color_map() {
-    std::ranges::copy(code.begin(), code.begin() + pegs, color_map.begin());
-    std::ranges::sort(color_map.begin(), color_map.begin() + pegs);
+            const size_t color = multiset_color;
+            multiset_pegs_left[color + 1] = multiset_pegs_left[color] - code_frequency_map[color];
+            if (is_multiset_feasible(color, multiset_pegs_left[color + 1])) {
+                if (multiset_pegs_left[color + 1] == 0) {
+                    // Arrangements of the multiset against the black pegs only, the totals are the same for all of them
+                    auto it = multiset_code.begin();
+                    for (Color c = 0; c <= color; ++c) {
+                        it = std::fill_n(it, code_frequency_map[c], c);
+                    }
+                    permutation_engine.reset(multiset_code);
+                    for (const auto& [old_guess_feedback, data] : history) {
+                        const auto& [old_guess, old_guess_frequency_map] = data;
+                        permutation_engine.add_constraint(old_guess, static_cast<std::uint8_t>(old_guess_feedback.black()));
+                    }
+                    arranging_multiset = true;
+                    continue;
+                }
+                else if (color + 1 < colors) {
+                    ++multiset_color;
+                    code_frequency_map[multiset_color] = multiset_pegs_left[multiset_color];
+                    continue;
+                }
+            }
+        }
 
-    Color c = 0;
-    size_t j = 0;
-    for (size_t i = pegs; i < colors; ++i) {
-        // Find next missing color
-        while (j < pegs && color_map[j] <= c) {
-            ++c;
-            ++j;
+        // The last color takes every peg left or the multiset is short
+        if (multiset_color + 1 == colors) {
+            code_frequency_map[multiset_color] = 0;
         }
 
-        color_map[i] = c++;
+        while (code_frequency_map[multiset_color] == 0) {
+            if (multiset_color == 0) {
+                co_return;
+            }
+            --multiset_color;
+        }
+        --code_frequency_map[multiset_color];
     }
 }
 
-void convert_inplace_code_and_frequency_map(Code& code, FrequencyMap& code_frequency_map, const std::vector<Color>& reverse_color_map, std::uint8_t pegs) {
-    std::ranges::fill(code_frequency_map, 0);
+bool Solver::is_multiset_feasible(size_t last_color, std::uint8_t pegs_left) const {
+    return std::ranges::all_of(history, [&](const auto& h) {
+        const auto& [old_guess_feedback, data] = h;
+        const auto& [old_guess, old_guess_frequency_map] = data;
 
-    for (Color& color : code | std::views::take(pegs)) {
-        color = reverse_color_map[color];
-        ++code_frequency_map[color];
-    }
+        // The colors after the last one have no peg yet, at most as many pegs as left can still match the guess
+        const std::uint8_t total = compare_and_count(code_frequency_map, old_guess_frequency_map, colors);
+        std::uint8_t guess_pegs_left = pegs;
+        for (size_t c = 0; c <= last_color; ++c) {
+            guess_pegs_left -= old_guess_frequency_map[static_cast<std::uint8_t>(c)];
+        }
+
+        const std::uint8_t target = static_cast<std::uint8_t>(old_guess_feedback.black() + old_guess_feedback.white());
+        return total <= target && total + std::min(pegs_left, guess_pegs_left) >= target;
+        });
 }
 
-void Solver::convert_code_and_history() {
-    std::vector<Color> reverse_color_map(colors, 0);
-    for (const auto [i, c] : std::views::enumerate(color_map)) {
-        reverse_color_map[c] = static_cast<Color>(i);
+void Solver::make_partial_guess() {
+    if (all_colors_known_mode || arranging_multiset) {
+        // An arrangement of the known colors or of the multiset, from the pegs the permutation engine placed so far
+        permutation_engine.write_frontier(partial_code);
+    }
+    else if (search_engine == SearchEngine::two_level) {
+        // The multiset built so far, its pegs left go to the next colors one each
+        auto it = partial_code.begin();
+        for (size_t color = 0; color <= multiset_color; ++color) {
+            it = std::fill_n(it, code_frequency_map[static_cast<std::uint8_t>(color)], static_cast<Color>(color));
+        }
+        for (size_t color = multiset_color + 1; it != partial_code.begin() + pegs; ++color) {
+            *it++ = static_cast<Color>(color % colors);
+        }
+    }
+    else {
+        // The prefix placed so far agrees with every history entry, the rest is left over from the previous branches
+        std::ranges::copy(code, partial_code.begin());
+        for (Color& color : partial_code | std::views::take(pegs)) {
+            if (color >= colors) {
+                color = 0;
+            }
+        }
+    }
+
+    // A code already played would only give its feedback again, the next codes in lexicographic order are
+    // tried instead, arrangements of the same colors when those are known. No more codes than entries were
+    // played, so one of that many next codes was not unless the arrangements run out.
+    const auto is_played = [&]() {
+        return std::ranges::any_of(history, [&](const auto& h) {
+            const auto& [old_guess_feedback, data] = h;
+            const auto& [old_guess, old_guess_frequency_map] = data;
+            return std::ranges::equal(old_guess | std::views::take(pegs), partial_code | std::views::take(pegs));
+            });
+    };
+    for (size_t i = 0; i < history.size() && is_played(); ++i) {
+        if (all_colors_known_mode || arranging_multiset) {
+            std::ranges::next_permutation(partial_code.begin(), partial_code.begin() + pegs);
+            continue;
+        }
+        for (size_t peg = pegs; peg-- > 0;) {
+            if (++partial_code[peg] < colors) {
+                break;
+            }
+            partial_code[peg] = 0;
+        }
     }
 
-    convert_inplace_code_and_frequency_map(code, code_frequency_map, reverse_color_map, pegs);
-    for (auto& [old_guess_feedback, data] : history) {
-        auto& [old_guess, old_guess_frequency_map] = data;
-        convert_inplace_code_and_frequency_map(old_guess, old_guess_frequency_map, reverse_color_map, pegs);
+    std::ranges::fill(partial_code_frequency_map, 0);
+    for (const Color color : partial_code | std::views::take(pegs)) {
+        ++partial_code_frequency_map[color];
     }
 }
 
-}
\ No newline at end of file
+}
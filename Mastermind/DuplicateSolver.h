@@ -2,20 +2,31 @@
 
 #include <array>
 #include <generator>
+#include <istream>
 #include <map>
 #include <new>
+#include <optional>
+#include <ostream>
+#include <span>
 #include <tuple>
 #include <vector>
 
 #include <immintrin.h>
 
 
+#include "CheckOrder.h"
 #include "Code.h"
 #include "Feedback.h"
+#include "GameTrace.h"
+#include "PermutationEngine.h"
+#include "SearchBudget.h"
 
 
 namespace duplicate {
 
+// Codes and frequency maps are padded so that the kernels load whole 16 byte lanes
+std::uint8_t ceil_to_multiple_of(std::uint8_t nb_bins, std::uint8_t multiple);
+
 class FrequencyMap {
     alignas(std::hardware_destructive_interference_size) std::vector<std::uint8_t> frequencyMap;
     std::uint8_t nb_bins;
@@ -172,35 +183,89 @@ public:
 
 
 
+enum class SearchEngine {
+    backtrack,      // Positions and colors explored jointly
+    two_level,      // Color multisets consistent with the black and white totals first, then their arrangements
+};
+
+class Counter;
+
 class Solver {
-    struct NewValue {};
+public:
+    using HistoryEntry = std::pair<const Feedback, History>;
+    using HistoryCheck = CheckOrder<HistoryEntry>::Check;
 
+private:
     const std::uint8_t pegs;
-    std::uint8_t colors;
+    const std::uint8_t colors;
     std::multimap<Feedback, History, std::greater<>> history;
+    std::vector<CheckOrder<HistoryEntry>> check_orders;
     FrequencyMap code_frequency_map;
     alignas(std::hardware_destructive_interference_size) Code code;
-    FrequencyMap converted_code_frequency_map;
-    alignas(std::hardware_destructive_interference_size) Code converted_code;
     size_t position;
     const size_t last_position;
     bool all_colors_known_mode;
-    std::vector<Color> color_map;
-    std::generator<NewValue> code_gen;
+    PermutationEngine permutation_engine;
+    const SearchEngine search_engine;
+    std::vector<std::uint8_t> multiset_pegs_left;
+    Code multiset_code;
+    size_t multiset_color;
+    bool arranging_multiset;
+    std::generator<SearchState> code_gen;
     decltype(code_gen.begin()) code_it;
+    SearchBudget budget;
+    bool search_pending;
+    bool partial_guess_played;
+    FrequencyMap partial_code_frequency_map;
+    Code partial_code;
     FeedbackCalculator feedback_calculator;
+    GameTrace* game_trace;
 
 public:
-    Solver(std::uint8_t pegs, std::uint8_t colors);
+    // Boards the solver handles: the pegs the permutation engine handles and frequency maps, padded to a
+    // multiple of 16 bins, sized in a byte
+    static constexpr bool supports(std::uint8_t pegs, std::uint8_t colors) {
+        return pegs != 0 && pegs <= PermutationEngine::max_pegs && colors != 0 && colors <= 240;
+    }
+
+    Solver(std::uint8_t pegs, std::uint8_t colors, SearchEngine search_engine = SearchEngine::two_level);
+
+    // Solver at the state reached after the moves, the search restarts from the first code
+    Solver(std::uint8_t pegs, std::uint8_t colors, std::span<const GameTrace::Move> moves, SearchEngine search_engine = SearchEngine::two_level);
+
+    // Records every guess and its feedback in the trace with a checkpoint of the solver, pass nullptr to stop recording
+    void set_game_trace(GameTrace* game_trace);
 
     FeedbackCalculator& get_feedback_calculator();
 
+    // Searches without a budget. Once no code is left can_continue() turns false and the guess is not to be played.
     std::tuple<const Code&, const FrequencyMap&> next_guess();
 
+    // Anytime variant: searches for at most the budget. Returns the first consistent code, or when interrupted
+    // a best effort guess built from the search frontier; the search resumes at the next call.
+    // No guess is to be played when no code is left.
+    std::tuple<const Code&, const FrequencyMap&, GuessQuality> next_guess(const SearchBudget& search_budget);
+
     void apply_feedback(const Feedback& feedback);
 
+    // False once a search has run out of codes, the feedbacks contradict each other. Never searches itself,
+    // a contradiction is only known after the next guess was asked for.
     bool can_continue() const;
 
+    // Exact number of codes consistent with the history, saturated at the largest std::uint64_t
+    std::uint64_t count_consistent() const;
+
+    // Estimate of the number of codes consistent with the history, for boards too large to count
+    double estimate_consistent(unsigned int nb_probes, unsigned int seed) const;
+
+    // Order in which the history entries are checked when placing a peg at the position, as learned so far
+    const std::vector<HistoryCheck>& get_check_order(size_t position) const;
+
+    // Checkpoint of the game and of the search, a solver loading it goes on exactly where the saved one stopped.
+    // Throws std::runtime_error if the checkpoint is truncated or was saved with other settings.
+    void save(std::ostream& stream) const;
+    void load(std::istream& stream);
+
 private:
     template<typename Pred>
         requires std::predicate<Pred, std::uint8_t, std::uint8_t>
@@ -214,25 +279,34 @@ private:
             return false;
         }
 
-        // White pegs
-        const std::uint8_t white = count_white_pegs(code_frequency_map, old_guess_frequency_map, colors, black);
-        return pred(white, old_guess_feedback.white());
+        // Black and white pegs together, with duplicates a later peg can turn a white peg of the prefix into a black one
+        const std::uint8_t total = compare_and_count(code_frequency_map, old_guess_frequency_map, colors);
+        return pred(total, old_guess_feedback.black() + old_guess_feedback.white());
     }
 
     inline bool is_same_feedback(const Code& old_guess, const Feedback& old_guess_feedback, const FrequencyMap& old_guess_frequency_map) {
         return compare_feedback(old_guess, old_guess_feedback, old_guess_frequency_map, std::equal_to<std::uint8_t>{});
     }
 
+    // Each peg left to place adds at most one black peg and one peg to the total
     inline bool is_similar_feedback(const Code& old_guess, const Feedback& old_guess_feedback, const FrequencyMap& old_guess_frequency_map) {
-        return compare_feedback(old_guess, old_guess_feedback, old_guess_frequency_map, std::less_equal<std::uint8_t>{});
+        const size_t pegs_left = last_position - position;
+        return compare_feedback(old_guess, old_guess_feedback, old_guess_frequency_map, [pegs_left](std::uint8_t count, std::uint8_t expected) {
+            return count <= expected && count + pegs_left >= expected;
+            });
     }
 
 
-    std::generator<NewValue> backtrack();
-    std::generator<NewValue> backtrack_using_only_code_colors();
+    Counter make_counter() const;
+    void add_to_history(const Code& guess, const FrequencyMap& guess_frequency_map, const Feedback& feedback);
+    // Empty once no code is left
+    std::optional<SearchState> resume_search(const SearchBudget& search_budget);
+    void make_partial_guess();
+    bool is_multiset_feasible(size_t last_color, std::uint8_t pegs_left) const;
 
-    void create_color_map();
-    void convert_code_and_history();
+    std::generator<SearchState> backtrack();
+    std::generator<SearchState> backtrack_permutations();
+    std::generator<SearchState> backtrack_multisets();
 };
 
 }
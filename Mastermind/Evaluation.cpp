@@ -0,0 +1,210 @@
+#include "Evaluation.h"
+#include "Serialization.h"
+#include <algorithm>
+#include <bit>
+#include <functional>
+#include <iterator>
+
+
+namespace {
+
+constexpr std::array<char, 4> magic{ 'M', 'M', 'E', 'R' };
+constexpr std::uint8_t version = 3;
+
+bool is_worse(const EvaluationResult::WorstCase& lhs, const EvaluationResult::WorstCase& rhs) {
+    if (lhs.nb_guesses != rhs.nb_guesses) {
+        return lhs.nb_guesses > rhs.nb_guesses;
+    }
+    return lhs.secret < rhs.secret;
+}
+
+}
+
+
+EvaluationResult::EvaluationResult(std::uint8_t pegs, std::uint8_t colors, unsigned int nb_tries, std::uint32_t shard, std::uint32_t nb_shards)
+    : pegs(pegs)
+    , colors(colors)
+    , nb_shards(nb_shards)
+    , nb_batches(0)
+    , shards{ shard }
+    , try_times(nb_tries, std::chrono::microseconds::zero())
+    , latency_histogram{}
+{}
+
+void EvaluationResult::add_game(unsigned int try_index, const Code& secret, unsigned int nb_guesses, std::chrono::microseconds time) {
+    try_times[try_index] += time;
+    ++latency_histogram[std::min<size_t>(std::bit_width(static_cast<std::uint64_t>(time.count())), nb_latency_buckets - 1)];
+    add_nb_guesses(try_index, secret, nb_guesses);
+}
+
+void EvaluationResult::add_batch_game(unsigned int try_index, const Code& secret, unsigned int nb_guesses) {
+    add_nb_guesses(try_index, secret, nb_guesses);
+}
+
+void EvaluationResult::add_batch(unsigned int try_index, std::chrono::microseconds time) {
+    try_times[try_index] += time;
+    ++nb_batches;
+}
+
+void EvaluationResult::add_nb_guesses(unsigned int try_index, const Code& secret, unsigned int nb_guesses) {
+    // Guesses do not change from one try to the other
+    if (try_index == 0) {
+        if (nb_guesses_histogram.size() <= nb_guesses) {
+            nb_guesses_histogram.resize(nb_guesses + 1, 0);
+        }
+        ++nb_guesses_histogram[nb_guesses];
+
+        add_worst_case({ Code(secret.begin(), secret.begin() + pegs), nb_guesses });
+    }
+}
+
+bool EvaluationResult::merge(const EvaluationResult& other) {
+    if (pegs != other.pegs || colors != other.colors || nb_shards != other.nb_shards || try_times.size() != other.try_times.size()
+        || (nb_batches == 0) != (other.nb_batches == 0)) {
+        return false;
+    }
+
+    std::vector<std::uint32_t> merged_shards;
+    std::ranges::set_union(shards, other.shards, std::back_inserter(merged_shards));
+    if (merged_shards.size() != shards.size() + other.shards.size()) {
+        return false;
+    }
+    shards = std::move(merged_shards);
+
+    nb_batches += other.nb_batches;
+    for (size_t i = 0; i < try_times.size(); ++i) {
+        try_times[i] += other.try_times[i];
+    }
+
+    if (nb_guesses_histogram.size() < other.nb_guesses_histogram.size()) {
+        nb_guesses_histogram.resize(other.nb_guesses_histogram.size(), 0);
+    }
+    for (size_t i = 0; i < other.nb_guesses_histogram.size(); ++i) {
+        nb_guesses_histogram[i] += other.nb_guesses_histogram[i];
+    }
+
+    for (size_t i = 0; i < nb_latency_buckets; ++i) {
+        latency_histogram[i] += other.latency_histogram[i];
+    }
+
+    for (const auto& worst_case : other.worst_cases) {
+        add_worst_case(worst_case);
+    }
+
+    return true;
+}
+
+void EvaluationResult::write(std::ostream& stream) const {
+    stream.write(magic.data(), magic.size());
+    write_value<std::uint8_t>(stream, version);
+    write_value<std::uint8_t>(stream, pegs);
+    write_value<std::uint8_t>(stream, colors);
+
+    write_value<std::uint32_t>(stream, nb_shards);
+    write_value<std::uint32_t>(stream, static_cast<std::uint32_t>(shards.size()));
+    for (const auto shard : shards) {
+        write_value<std::uint32_t>(stream, shard);
+    }
+
+    write_value<std::uint64_t>(stream, nb_batches);
+    write_value<std::uint32_t>(stream, static_cast<std::uint32_t>(try_times.size()));
+    for (const auto time : try_times) {
+        write_value<std::int64_t>(stream, time.count());
+    }
+
+    write_value<std::uint32_t>(stream, static_cast<std::uint32_t>(nb_guesses_histogram.size()));
+    for (const auto nb_games : nb_guesses_histogram) {
+        write_value<std::uint64_t>(stream, nb_games);
+    }
+
+    for (const auto nb_games : latency_histogram) {
+        write_value<std::uint64_t>(stream, nb_games);
+    }
+
+    write_value<std::uint32_t>(stream, static_cast<std::uint32_t>(worst_cases.size()));
+    for (const auto& [secret, nb_guesses] : worst_cases) {
+        stream.write(reinterpret_cast<const char*>(secret.data()), pegs);
+        write_value<std::uint32_t>(stream, nb_guesses);
+    }
+}
+
+std::optional<EvaluationResult> EvaluationResult::read(std::istream& stream) {
+    std::array<char, 4> file_magic{};
+    stream.read(file_magic.data(), file_magic.size());
+    if (!stream || file_magic != magic || read_value<std::uint8_t>(stream) != version) {
+        return std::nullopt;
+    }
+
+    const auto pegs = read_value<std::uint8_t>(stream);
+    const auto colors = read_value<std::uint8_t>(stream);
+    if (pegs == 0 || colors == 0) {
+        return std::nullopt;
+    }
+
+    const auto nb_shards = read_value<std::uint32_t>(stream);
+    const auto nb_read_shards = read_value<std::uint32_t>(stream);
+    if (nb_shards == 0 || nb_shards > max_nb_shards || nb_read_shards == 0 || nb_read_shards > nb_shards) {
+        return std::nullopt;
+    }
+    std::vector<std::uint32_t> shards(nb_read_shards);
+    for (auto& shard : shards) {
+        shard = read_value<std::uint32_t>(stream);
+    }
+    // Increasing, so that no shard is counted twice
+    if (shards.back() >= nb_shards || std::ranges::adjacent_find(shards, std::greater_equal<>{}) != shards.end()) {
+        return std::nullopt;
+    }
+
+    const auto nb_batches = read_value<std::uint64_t>(stream);
+    const auto nb_tries = read_value<std::uint32_t>(stream);
+    if (!stream || nb_tries == 0 || nb_tries > max_nb_tries) {
+        return std::nullopt;
+    }
+    EvaluationResult result(pegs, colors, nb_tries, 0, nb_shards);
+    result.shards = std::move(shards);
+    result.nb_batches = nb_batches;
+
+    for (auto& time : result.try_times) {
+        time = std::chrono::microseconds(read_value<std::int64_t>(stream));
+    }
+
+    const auto nb_guesses_histogram_size = read_value<std::uint32_t>(stream);
+    if (!stream || nb_guesses_histogram_size > max_nb_guesses) {
+        return std::nullopt;
+    }
+    result.nb_guesses_histogram.resize(nb_guesses_histogram_size);
+    for (auto& nb_games : result.nb_guesses_histogram) {
+        nb_games = read_value<std::uint64_t>(stream);
+    }
+
+    for (auto& nb_games : result.latency_histogram) {
+        nb_games = read_value<std::uint64_t>(stream);
+    }
+
+    const auto nb_read_worst_cases = read_value<std::uint32_t>(stream);
+    if (!stream || nb_read_worst_cases > nb_worst_cases) {
+        return std::nullopt;
+    }
+    result.worst_cases.resize(nb_read_worst_cases);
+    for (auto& [secret, nb_guesses] : result.worst_cases) {
+        secret.resize(pegs);
+        stream.read(reinterpret_cast<char*>(secret.data()), pegs);
+        nb_guesses = read_value<std::uint32_t>(stream);
+    }
+
+    if (!stream) {
+        return std::nullopt;
+    }
+
+    return result;
+}
+
+void EvaluationResult::add_worst_case(const WorstCase& worst_case) {
+    const auto it = std::ranges::upper_bound(worst_cases, worst_case, is_worse);
+    if (it - worst_cases.begin() < static_cast<std::ptrdiff_t>(nb_worst_cases)) {
+        worst_cases.insert(it, worst_case);
+        if (worst_cases.size() > nb_worst_cases) {
+            worst_cases.pop_back();
+        }
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <istream>
+#include <optional>
+#include <ostream>
+#include <vector>
+
+#include "Code.h"
+
+
+// EvaluationResult: summary of the games played over a shard of the secret space. Results of the
+// shards are written to compact binary files and merged back into the report of the whole evaluation.
+class EvaluationResult {
+public:
+    static constexpr size_t nb_worst_cases = 16;
+    static constexpr size_t nb_latency_buckets = 64;
+    // Bounds on the lengths read back from a file, far above anything an evaluation produces
+    static constexpr unsigned int max_nb_tries = 1 << 16;
+    static constexpr unsigned int max_nb_shards = 1 << 16;
+    static constexpr size_t max_nb_guesses = 1 << 12;
+
+    struct WorstCase {
+        Code secret;
+        unsigned int nb_guesses;
+    };
+
+private:
+    std::uint8_t pegs;
+    std::uint8_t colors;
+    std::uint32_t nb_shards;
+    std::uint64_t nb_batches;                                       // Batches solved, none when the games are timed one by one
+    std::vector<std::uint32_t> shards;                              // Shards merged so far, in increasing order
+    std::vector<std::chrono::microseconds> try_times;               // Time of each try over all the secrets
+    std::vector<std::uint64_t> nb_guesses_histogram;                // Games per number of guesses, first try only
+    std::array<std::uint64_t, nb_latency_buckets> latency_histogram; // Games per bit width of their time in microseconds, single games only
+    std::vector<WorstCase> worst_cases;                             // Most guesses first, first try only
+
+public:
+    EvaluationResult(std::uint8_t pegs, std::uint8_t colors, unsigned int nb_tries, std::uint32_t shard = 0, std::uint32_t nb_shards = 1);
+
+    void add_game(unsigned int try_index, const Code& secret, unsigned int nb_guesses, std::chrono::microseconds time);
+
+    // Games solved in a batch share their searches, only the time of the whole batch is known
+    void add_batch_game(unsigned int try_index, const Code& secret, unsigned int nb_guesses);
+    void add_batch(unsigned int try_index, std::chrono::microseconds time);
+
+    // Returns false if the results are not from the same evaluation settings or share a shard
+    bool merge(const EvaluationResult& other);
+
+    // Every shard 0..N-1 has been merged
+    bool is_complete() const { return shards.size() == nb_shards; }
+
+    void write(std::ostream& stream) const;
+    static std::optional<EvaluationResult> read(std::istream& stream);
+
+    std::uint64_t get_nb_batches() const { return nb_batches; }
+    const std::vector<std::chrono::microseconds>& get_try_times() const { return try_times; }
+    const std::vector<std::uint64_t>& get_nb_guesses_histogram() const { return nb_guesses_histogram; }
+    const std::array<std::uint64_t, nb_latency_buckets>& get_latency_histogram() const { return latency_histogram; }
+    const std::vector<WorstCase>& get_worst_cases() const { return worst_cases; }
+
+private:
+    void add_nb_guesses(unsigned int try_index, const Code& secret, unsigned int nb_guesses);
+    void add_worst_case(const WorstCase& worst_case);
+};
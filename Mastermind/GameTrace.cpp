@@ -0,0 +1,84 @@
+#include "GameTrace.h"
+#include "Serialization.h"
+#include <algorithm>
+#include <array>
+
+
+namespace {
+
+constexpr std::array<char, 2> magic{ 'G', 'T' };
+constexpr std::uint8_t version = 2;
+
+}
+
+
+GameTrace::GameTrace(std::uint8_t pegs, std::uint8_t colors)
+    : pegs(pegs)
+    , colors(colors)
+{}
+
+void GameTrace::add_move(const Code& guess, const Feedback& feedback) {
+    moves.emplace_back(Code(guess.begin(), guess.begin() + pegs), feedback);
+}
+
+void GameTrace::set_checkpoint(std::string checkpoint) {
+    moves.back().checkpoint = std::move(checkpoint);
+}
+
+void GameTrace::write(std::ostream& stream) const {
+    // Magic, version, pegs, colors, number of moves, then for each move its colors, black and white pegs and checkpoint
+    stream.write(magic.data(), magic.size());
+    stream.put(static_cast<char>(version));
+    stream.put(static_cast<char>(pegs));
+    stream.put(static_cast<char>(colors));
+    write_value<std::uint32_t>(stream, static_cast<std::uint32_t>(moves.size()));
+    for (const auto& [guess, feedback, checkpoint] : moves) {
+        stream.write(reinterpret_cast<const char*>(guess.data()), pegs);
+        stream.put(static_cast<char>(feedback.black()));
+        stream.put(static_cast<char>(feedback.white()));
+        write_value<std::uint32_t>(stream, static_cast<std::uint32_t>(checkpoint.size()));
+        stream.write(checkpoint.data(), checkpoint.size());
+    }
+}
+
+std::optional<GameTrace> GameTrace::read(std::istream& stream) {
+    std::array<char, 2> trace_magic{};
+    stream.read(trace_magic.data(), trace_magic.size());
+    if (!stream || trace_magic != magic) {
+        return std::nullopt;
+    }
+
+    std::array<std::uint8_t, 3> header{};
+    stream.read(reinterpret_cast<char*>(header.data()), header.size());
+    const auto [trace_version, pegs, colors] = header;
+    const auto nb_moves = read_value<std::uint32_t>(stream);
+    if (!stream || trace_version != version || pegs == 0 || colors == 0 || nb_moves > max_nb_moves) {
+        return std::nullopt;
+    }
+
+    GameTrace game_trace(pegs, colors);
+    Code guess(pegs);
+    for (std::uint32_t i = 0; i < nb_moves; ++i) {
+        stream.read(reinterpret_cast<char*>(guess.data()), pegs);
+        const auto black = static_cast<std::uint8_t>(stream.get());
+        const auto white = static_cast<std::uint8_t>(stream.get());
+        if (std::ranges::any_of(guess, [colors](Color color) { return color >= colors; }) || black + white > pegs) {
+            return std::nullopt;
+        }
+        game_trace.add_move(guess, { black, white });
+
+        const auto checkpoint_size = read_value<std::uint32_t>(stream);
+        if (!stream || checkpoint_size > max_checkpoint_size) {
+            return std::nullopt;
+        }
+        std::string checkpoint(checkpoint_size, '\0');
+        stream.read(checkpoint.data(), checkpoint_size);
+        game_trace.set_checkpoint(std::move(checkpoint));
+    }
+
+    if (!stream) {
+        return std::nullopt;
+    }
+
+    return game_trace;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "Code.h"
+#include "Feedback.h"
+
+
+// GameTrace: guesses and feedbacks of one game, enough to rebuild a solver at any state of the game,
+// with the checkpoints of the solver when they were recorded. Traces are written one after the other
+// in a compact binary form.
+class GameTrace {
+public:
+    struct Move {
+        Code guess;
+        Feedback feedback;
+        std::string checkpoint;     // Solver saved right after the feedback, empty if not recorded
+    };
+
+    // Bounds on the lengths read back from a file
+    static constexpr std::uint32_t max_nb_moves = 1 << 12;
+    static constexpr std::uint32_t max_checkpoint_size = 1 << 24;
+
+private:
+    std::uint8_t pegs;
+    std::uint8_t colors;
+    std::vector<Move> moves;
+
+public:
+    GameTrace(std::uint8_t pegs, std::uint8_t colors);
+
+    void add_move(const Code& guess, const Feedback& feedback);
+
+    // Attaches the checkpoint of the solver to the last move
+    void set_checkpoint(std::string checkpoint);
+
+    std::uint8_t get_pegs() const { return pegs; }
+    std::uint8_t get_colors() const { return colors; }
+    const std::vector<Move>& get_moves() const { return moves; }
+
+    void write(std::ostream& stream) const;
+
+    // Returns nullopt at the end of the stream or on an invalid trace
+    static std::optional<GameTrace> read(std::istream& stream);
+};
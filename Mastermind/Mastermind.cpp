@@ -2,16 +2,34 @@
 //
 
 #include <cassert>
+#include <charconv>
 #include <chrono>
+#include <fstream>
 #include <iostream>
 #include <numeric>
+#include <optional>
 #include <random>
 #include <ranges>
-
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include "BatchSolver.h"
 #include "Code.h"
+#include "Evaluation.h"
 #include "Feedback.h"
+#include "GameTrace.h"
+#include "DuplicateAdversary.h"
+#include "DuplicateGeneticSolver.h"
+#include "DuplicateMonteCarloSolver.h"
 #include "DuplicateSolver.h"
+#include "NoDuplicateAdversary.h"
 #include "NoDuplicateSolver.h"
+#include "Replay.h"
+#include "Trace.h"
 
 
 
@@ -77,24 +95,19 @@ std::ostream& operator<<(std::ostream& stream, const TimeStatistics& statistics)
 }
 
 
-TimeStatistics compute_time_statistics(const std::vector<std::vector<std::chrono::microseconds>>& times)
+TimeStatistics compute_time_statistics(const std::vector<std::chrono::microseconds>& try_times)
 {
-    std::vector<std::chrono::microseconds> mean_times;
-    mean_times.reserve(times.size());
-
     auto total = std::chrono::microseconds::zero();
     auto min = std::chrono::microseconds::max();
     auto max = std::chrono::microseconds::min();
 
-    for (const auto& t : times) {
-        const auto current_run_time = std::accumulate(t.begin(), t.end(), std::chrono::microseconds::zero());
-        mean_times.emplace_back(current_run_time);
+    for (const auto current_run_time : try_times) {
         total += current_run_time;
         min = std::min(min, current_run_time);
         max = std::max(max, current_run_time);
     }
 
-    return { std::move(mean_times), total, min, max };
+    return { std::vector<std::chrono::microseconds>(try_times), total, min, max };
 }
 
 
@@ -119,22 +132,112 @@ std::ostream& operator<<(std::ostream& stream, const NbGuessStatistics& statisti
     return stream;
 }
 
-NbGuessStatistics compute_nb_guesses_statistics(const std::vector<unsigned int>& nb_guesses) {
-    const auto total = std::accumulate(nb_guesses.begin(), nb_guesses.end(), 0u);
-    const auto mean = static_cast<double>(total) / nb_guesses.size();
+NbGuessStatistics compute_nb_guesses_statistics(const std::vector<std::uint64_t>& nb_guesses_histogram) {
+    unsigned int total = 0;
+    std::uint64_t nb_games = 0;
+    for (const auto [nb_guesses, nb_games_with_nb_guesses] : std::views::enumerate(nb_guesses_histogram)) {
+        total += static_cast<unsigned int>(nb_guesses * nb_games_with_nb_guesses);
+        nb_games += nb_games_with_nb_guesses;
+    }
+    const auto mean = static_cast<double>(total) / nb_games;
     return { total, mean };
 }
 
-template<class Solver> inline std::tuple<Code, unsigned int> solve(std::uint8_t pegs, std::uint8_t colors, const Code& secret)
+void print_report(const EvaluationResult& result) {
+    const auto time_statistics = compute_time_statistics(result.get_try_times());
+    const auto guesses_statistics = compute_nb_guesses_statistics(result.get_nb_guesses_histogram());
+
+    std::cout << time_statistics << '\n';
+    std::cout << guesses_statistics << '\n';
+
+    // Games solved in a batch have no time of their own
+    if (result.get_nb_batches() != 0) {
+        std::cout << "Batches: " << result.get_nb_batches() << ' '
+            << "Per batch: " << time_statistics.get_total() / result.get_nb_batches() << '\n';
+    }
+    else {
+        std::cout << "Latency:";
+        for (const auto [bucket, nb_games] : std::views::enumerate(result.get_latency_histogram())) {
+            if (nb_games != 0) {
+                std::cout << " <" << (std::uint64_t{ 1 } << bucket) << "us: " << nb_games;
+            }
+        }
+        std::cout << '\n';
+    }
+
+    std::cout << "Worst secrets:";
+    for (const auto& [secret, nb_guesses] : result.get_worst_cases()) {
+        std::cout << ' ' << secret << " (" << nb_guesses << ')';
+    }
+    std::cout << '\n';
+}
+
+// Secret of the given index when enumerating every code of the board
+Code code_from_index(std::uint8_t pegs, std::uint8_t colors, std::uint64_t index) {
+    Code code(pegs);
+    for (Color& color : code) {
+        color = static_cast<Color>(index % colors);
+        index /= colors;
+    }
+    return code;
+}
+
+template<class Solver> inline std::tuple<Code, unsigned int> solve(std::uint8_t pegs, std::uint8_t colors, const Code& secret, GameTrace* game_trace = nullptr)
 {
     unsigned int nb_guesses = 0;
     Code final_guess;
     Solver solver(pegs, colors);
+    solver.set_game_trace(game_trace);
     auto feedback_calculator = solver.get_feedback_calculator();
     feedback_calculator.set_secret(secret);
     while (solver.can_continue()) {
+        const auto& [guess, guess_frequency_map] = solver.next_guess();
+        if (!solver.can_continue()) {
+            break;
+        }
         ++nb_guesses;
+        Feedback feedback = feedback_calculator.get_feedback(guess, guess_frequency_map);
+        if (feedback.black() == pegs) {
+            if (game_trace) {
+                game_trace->add_move(guess, feedback);
+            }
+            final_guess = guess;
+            break;
+        }
+        solver.apply_feedback(feedback);
+    }
+
+    return { final_guess, nb_guesses };
+}
+
+// Solves the secrets in lockstep, sharing the searches of the games. Solvers that cannot fork their state
+// are never given a batch, their results are left empty.
+template<class Solver> inline std::vector<std::tuple<Code, unsigned int>> solve_batch(std::uint8_t pegs, std::uint8_t colors, std::span<const Code> secrets)
+{
+    std::vector<std::tuple<Code, unsigned int>> results(secrets.size());
+    if constexpr (Checkpointable<Solver>) {
+        const auto batch_results = BatchSolver<Solver>(pegs, colors).solve(secrets);
+        for (size_t i = 0; i < secrets.size(); ++i) {
+            results[i] = { batch_results[i].final_guess, batch_results[i].nb_guesses };
+        }
+    }
+    return results;
+}
+
+// Plays a single game against an adversary committing to no secret. The number of guesses is a lower bound
+// on the solver's worst case, only an exhaustive evaluation gives the worst case itself.
+template<class Solver, class AdversarialFeedbackCalculator> inline std::tuple<Code, unsigned int> solve_against_adversary(std::uint8_t pegs, std::uint8_t colors)
+{
+    unsigned int nb_guesses = 0;
+    Code final_guess;
+    Solver solver(pegs, colors);
+    AdversarialFeedbackCalculator feedback_calculator(pegs, colors);
+    while (solver.can_continue()) {
         const auto& [guess, guess_frequency_map] = solver.next_guess();
+        if (!solver.can_continue()) {
+            break;
+        }
+        ++nb_guesses;
         Feedback feedback = feedback_calculator.get_feedback(guess, guess_frequency_map);
         if (feedback.black() == pegs) {
             final_guess = guess;
@@ -146,48 +249,250 @@ template<class Solver> inline std::tuple<Code, unsigned int> solve(std::uint8_t
     return { final_guess, nb_guesses };
 }
 
-int main() {
+int main(int argc, char* argv[]) {
     const std::uint8_t pegs = 5;
     const std::uint8_t colors = 8;
 
-    constexpr unsigned int nb_tries = 100;
-    constexpr unsigned int count = 200;
+    unsigned int nb_tries = 100;
+    std::uint64_t count = 200;
 
-    std::vector<std::vector<std::chrono::microseconds>> all_times;
-    std::vector<unsigned int> all_nb_guesses;
+    const std::vector<std::string_view> args(argv + 1, argv + argc);
 
-    all_times.reserve(count);
-    all_nb_guesses.reserve(count);
+    // Merge the results written by the shards into the report of the whole evaluation
+    if (!args.empty() && args.front() == "--merge") {
+        std::optional<EvaluationResult> result;
+        for (const auto path : args | std::views::drop(1)) {
+            std::ifstream file{ std::string(path), std::ios::binary };
+            auto shard_result = EvaluationResult::read(file);
+            if (!shard_result || (result && !result->merge(*shard_result))) {
+                std::cout << "Invalid shard result: " << path << std::endl;
+                return 1;
+            }
+            if (!result) {
+                result = std::move(shard_result);
+            }
+        }
+
+        if (!result) {
+            std::cout << "Usage: Mastermind --merge <shard result>..." << std::endl;
+            return 1;
+        }
+        if (!result->is_complete()) {
+            std::cout << "Missing shard results" << std::endl;
+            return 1;
+        }
+
+        print_report(*result);
+        return 0;
+    }
+
+    // Benchmark the search at every state of the recorded games, slowest states first
+    if (!args.empty() && args.front() == "--replay") {
+        unsigned int nb_iterations = 100;
+        bool valid_args = args.size() == 2;
+        if (args.size() == 4 && args[2] == "--iterations") {
+            const auto [end, error] = std::from_chars(args[3].data(), args[3].data() + args[3].size(), nb_iterations);
+            valid_args = error == std::errc{} && end == args[3].data() + args[3].size() && nb_iterations != 0;
+        }
+        if (!valid_args) {
+            std::cout << "Usage: Mastermind --replay <game traces> [--iterations N]" << std::endl;
+            return 1;
+        }
+
+        //using Solver = no_duplicate::Solver;
+        using Solver = duplicate::Solver;
+
+        struct ReplayedState {
+            size_t game;
+            size_t nb_moves;
+            ReplayStatistics statistics;
+        };
+        std::vector<ReplayedState> states;
+
+        std::ifstream file{ std::string(args[1]), std::ios::binary };
+        if (!file) {
+            std::cout << "Cannot open game traces: " << args[1] << std::endl;
+            return 1;
+        }
+        try {
+            for (size_t game = 0; const auto game_trace = GameTrace::read(file); ++game) {
+                if (!Solver::supports(game_trace->get_pegs(), game_trace->get_colors())) {
+                    std::cout << "Game traces of a board the solver does not support" << std::endl;
+                    return 1;
+                }
+                for (size_t nb_moves = 0; nb_moves < game_trace->get_moves().size(); ++nb_moves) {
+                    states.emplace_back(game, nb_moves, benchmark_state<Solver>(*game_trace, nb_moves, nb_iterations));
+                }
+            }
+        }
+        catch (const std::runtime_error& error) {
+            std::cout << "Invalid checkpoint in game traces: " << error.what() << std::endl;
+            return 1;
+        }
+
+        std::ranges::sort(states, std::greater<>{}, [](const ReplayedState& state) { return state.statistics.median; });
+        for (const auto& [game, nb_moves, statistics] : states | std::views::take(10)) {
+            std::cout << "Game " << game << " after " << nb_moves << " moves: "
+                << "Median: " << statistics.median << ' '
+                << "Min: " << statistics.min << ' '
+                << "Guess: " << statistics.guess
+                << (statistics.matches_trace ? "" : " (differs from trace)")
+                << (statistics.rescanned ? " (rescan from the first code)" : "") << '\n';
+        }
+        return 0;
+    }
+
+    // Secrets are dealt to the shards round robin, so every shard gets the same share of each kind of secret
+    unsigned int shard = 0;
+    unsigned int nb_shards = 1;
+    bool exhaustive = false;
+    bool batch = false;
+    std::string output;
+    std::ofstream record_file;
+    for (size_t i = 0; i < args.size(); ++i) {
+        if (args[i] == "--shard" && i + 1 < args.size()) {
+            const auto shard_arg = args[++i];
+            const auto separator = shard_arg.find('/');
+            // Both numbers up to their last character, as for the number of tries
+            const auto parse_number = [](std::string_view number_arg, unsigned int& number) {
+                const auto [end, error] = std::from_chars(number_arg.data(), number_arg.data() + number_arg.size(), number);
+                return error == std::errc{} && end == number_arg.data() + number_arg.size();
+            };
+            if (separator == std::string_view::npos
+                || !parse_number(shard_arg.substr(0, separator), shard)
+                || !parse_number(shard_arg.substr(separator + 1), nb_shards)
+                || shard >= nb_shards || nb_shards > EvaluationResult::max_nb_shards) {
+                std::cout << "Invalid shard: " << shard_arg << std::endl;
+                return 1;
+            }
+        }
+        else if (args[i] == "--output" && i + 1 < args.size()) {
+            output = args[++i];
+        }
+        else if (args[i] == "--tries" && i + 1 < args.size()) {
+            const auto tries_arg = args[++i];
+            const auto [end, error] = std::from_chars(tries_arg.data(), tries_arg.data() + tries_arg.size(), nb_tries);
+            if (error != std::errc{} || end != tries_arg.data() + tries_arg.size() || nb_tries == 0 || nb_tries > EvaluationResult::max_nb_tries) {
+                std::cout << "Invalid number of tries: " << tries_arg << std::endl;
+                return 1;
+            }
+        }
+        else if (args[i] == "--record" && i + 1 < args.size()) {
+            record_file.open(std::string(args[++i]), std::ios::binary);
+        }
+        else if (args[i] == "--exhaustive") {
+            exhaustive = true;
+        }
+        else if (args[i] == "--batch") {
+            batch = true;
+        }
+        else {
+            std::cout << "Usage: Mastermind [--shard i/N] [--output <shard result>] [--tries N] [--exhaustive] [--record <game traces> | --batch]\n"
+                << "       Mastermind --merge <shard result>...\n"
+                << "       Mastermind --replay <game traces> [--iterations N]" << std::endl;
+            return 1;
+        }
+    }
+
+    if (exhaustive) {
+        count = 1;
+        for (std::uint8_t i = 0; i < pegs; ++i) {
+            count *= colors;
+        }
+    }
+
+    if (batch && record_file.is_open()) {
+        std::cout << "Games solved in a batch cannot be recorded" << std::endl;
+        return 1;
+    }
+
+    EvaluationResult result(pegs, colors, nb_tries, shard, nb_shards);
+
+    //using Solver = no_duplicate::Solver;
+    //using Solver = duplicate::MonteCarloSolver;
+    //using Solver = duplicate::GeneticSolver;
+    using Solver = duplicate::Solver;
+
+    if (batch && !Checkpointable<Solver>) {
+        std::cout << "The solver cannot fork its state, its games cannot be solved in a batch" << std::endl;
+        return 1;
+    }
 
     for (auto i : std::views::iota(0u, nb_tries)) {
-        all_times.emplace_back();
-        all_times.back().reserve(count);
-        for (auto j : std::views::iota(0u, count)) {
-            const Code secret = generate_secret_no_duplicate(pegs, colors, 42 + j);    // Pseudo-random secret
+        if (batch) {
+            std::vector<Code> secrets;
+            for (std::uint64_t j = shard; j < count; j += nb_shards) {
+                secrets.push_back(exhaustive
+                    ? code_from_index(pegs, colors, j)
+                    : generate_secret_no_duplicate(pegs, colors, static_cast<unsigned int>(42 + j)));
+            }
+
+            Timer timer;
+            const auto results = solve_batch<Solver>(pegs, colors, secrets);
+            result.add_batch(i, timer.elapsed_seconds());
+
+            for (size_t j = 0; j < secrets.size(); ++j) {
+                const auto& [final_guess, nb_guesses] = results[j];
+                if ((final_guess | std::views::take(pegs) | std::ranges::to<Code>()) != secrets[j]) {
+                    std::cout << "Error for secret: " << secrets[j] << std::endl;
+                    return 0;
+                }
+                result.add_batch_game(i, secrets[j], nb_guesses);
+            }
+            continue;
+        }
+
+        for (std::uint64_t j = shard; j < count; j += nb_shards) {
+            const Code secret = exhaustive
+                ? code_from_index(pegs, colors, j)
+                : generate_secret_no_duplicate(pegs, colors, static_cast<unsigned int>(42 + j));    // Pseudo-random secret
 
-            //using Solver = no_duplicate::Solver;
-            using Solver = duplicate::Solver;
+            // Games are recorded once, the guesses do not change from one try to the other
+            std::optional<GameTrace> game_trace;
+            if (i == 0 && record_file.is_open()) {
+                game_trace.emplace(pegs, colors);
+            }
 
+            TRACE_GAME(static_cast<std::uint32_t>(i * count + j));
             Timer timer;
-            auto [final_guess, nb_guesses] = solve<Solver>(pegs, colors, secret);
+            auto [final_guess, nb_guesses] = solve<Solver>(pegs, colors, secret, game_trace ? &*game_trace : nullptr);
             const auto elapsed_time = timer.elapsed_seconds();
 
-            all_times.back().emplace_back(elapsed_time);
+            if (game_trace) {
+                game_trace->write(record_file);
+            }
+
             if ((final_guess | std::views::take(pegs) | std::ranges::to<Code>()) != secret) {
                 std::cout << "Error for secret: " << secret << std::endl;
                 return 0;
             }
-            if (i == 0) {
-                all_nb_guesses.emplace_back(nb_guesses);
-            }
+            result.add_game(i, secret, nb_guesses, elapsed_time);
         }
     }
 
-    const auto time_statistics = compute_time_statistics(all_times);
-    const auto guesses_statistics = compute_nb_guesses_statistics(all_nb_guesses);
+    if (!output.empty()) {
+        std::ofstream file(output, std::ios::binary);
+        result.write(file);
+        if (!file) {
+            std::cout << "Cannot write shard result: " << output << std::endl;
+            return 1;
+        }
+        return 0;
+    }
 
-    std::cout << time_statistics << '\n';
-    std::cout << guesses_statistics << '\n';
+    print_report(result);
+
+    //using AdversarialFeedbackCalculator = no_duplicate::AdversarialFeedbackCalculator;
+    using AdversarialFeedbackCalculator = duplicate::AdversarialFeedbackCalculator;
+
+    const auto [adversary_secret, adversary_nb_guesses] = solve_against_adversary<Solver, AdversarialFeedbackCalculator>(pegs, colors);
+    std::cout << "Greedy adversary: " << adversary_nb_guesses << " guesses for secret " << (adversary_secret | std::views::take(pegs) | std::ranges::to<Code>())
+        << " (lower bound on the worst case)\n";
+
+#ifdef MASTERMIND_TRACING
+    std::ofstream trace_file("mastermind_trace.json");
+    trace::write_chrome_trace(trace_file);
+#endif
 
     return 0;
 }
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "AdversarialFeedbackCalculator.h"
+#include "NoDuplicateCounter.h"
+#include "NoDuplicateSolver.h"
+
+
+namespace no_duplicate {
+
+using AdversarialFeedbackCalculator = ::AdversarialFeedbackCalculator<Counter, FrequencyMap>;
+
+}
@@ -0,0 +1,242 @@
+#include "NoDuplicateCounter.h"
+#include "Saturating.h"
+#include <random>
+
+
+namespace no_duplicate {
+
+Counter::Counter(std::uint8_t pegs, std::uint8_t colors)
+    : pegs(pegs)
+    , colors(colors)
+    , nb_irrelevant_colors(colors)
+{}
+
+void Counter::add_constraint(const Code& guess, const FrequencyMap& guess_frequency_map, const Feedback& feedback) {
+    constraints.emplace_back(
+        Code(guess.begin(), guess.begin() + pegs),
+        guess_frequency_map,
+        static_cast<std::uint8_t>(feedback.black()),
+        static_cast<std::uint8_t>(feedback.black() + feedback.white()));
+}
+
+std::uint64_t Counter::count() {
+    prepare();
+    return count_from(0);
+}
+
+double Counter::estimate(unsigned int nb_probes, unsigned int seed) {
+    prepare();
+
+    std::mt19937 rng(seed);
+    std::vector<Color> candidates;
+    candidates.reserve(colors);
+    std::vector<Color> path;
+    path.reserve(pegs);
+
+    double sum = 0.0;
+    for (unsigned int probe = 0; probe < nb_probes; ++probe) {
+        double weight = 1.0;
+        for (size_t position = 0; position < pegs; ++position) {
+            const size_t remaining = pegs - position - 1;
+            candidates.clear();
+            for (Color color : relevant_colors) {
+                if (used.test(color)) {
+                    continue;
+                }
+
+                place(color, position);
+                if (is_feasible(remaining)) {
+                    candidates.push_back(color);
+                }
+                unplace(color, position);
+            }
+
+            // Unused irrelevant colors are interchangeable, they are checked once and weighted by their number
+            const std::uint8_t nb_free = nb_free_irrelevant_colors(position);
+            const size_t nb_irrelevant = nb_free != 0 && is_feasible(remaining) ? nb_free : 0;
+            const size_t nb_children = candidates.size() + nb_irrelevant;
+            if (nb_children == 0) {
+                weight = 0.0;
+                break;
+            }
+
+            weight *= static_cast<double>(nb_children);
+            const size_t child = std::uniform_int_distribution<size_t>(0, nb_children - 1)(rng);
+            const Color color = child < candidates.size() ? candidates[child] : colors;
+            if (color != colors) {
+                place(color, position);
+            }
+            path.push_back(color);
+        }
+
+        sum += weight;
+
+        for (size_t position = path.size(); position-- > 0;) {
+            if (path[position] != colors) {
+                unplace(path[position], position);
+            }
+        }
+        path.clear();
+    }
+
+    return nb_probes == 0 ? 0.0 : sum / nb_probes;
+}
+
+std::vector<std::uint64_t> Counter::partition(const Code& guess, const FrequencyMap& guess_frequency_map) {
+    probe.assign(guess.begin(), guess.begin() + pegs);
+    probe_frequency_map = guess_frequency_map;
+    prepare(probe_frequency_map);
+
+    const size_t stride = pegs + 1;
+    consistent_leaf.assign(stride * stride, 0);
+    consistent_leaf[0] = 1;
+    inconsistent_leaf.assign(stride * stride, 0);
+    partition_memo.assign(pegs, {});
+
+    // Histogram over (black, black + white) to histogram over (black, white)
+    const auto& totals_histogram = partition_from(0);
+    std::vector<std::uint64_t> histogram(stride * stride, 0);
+    for (size_t black = 0; black <= pegs; ++black) {
+        for (size_t total = black; total <= pegs; ++total) {
+            histogram[black * stride + total - black] = totals_histogram[black * stride + total];
+        }
+    }
+    return histogram;
+}
+
+void Counter::prepare(const FrequencyMap& extra_colors) {
+    FrequencyMap relevant = extra_colors;
+    for (const auto& constraint : constraints) {
+        relevant |= constraint.guess_frequency_map;
+    }
+
+    relevant_colors.clear();
+    for (Color color = 0; color < colors; ++color) {
+        if (relevant.test(color)) {
+            relevant_colors.push_back(color);
+        }
+    }
+    nb_irrelevant_colors = static_cast<std::uint8_t>(colors - relevant_colors.size());
+
+    blacks.assign(constraints.size(), 0);
+    used.reset();
+    memo.assign(pegs, {});
+}
+
+void Counter::place(Color color, size_t position) {
+    for (size_t i = 0; i < constraints.size(); ++i) {
+        blacks[i] += constraints[i].guess[position] == color;
+    }
+    used.set(color);
+}
+
+void Counter::unplace(Color color, size_t position) {
+    used.reset(color);
+    for (size_t i = 0; i < constraints.size(); ++i) {
+        blacks[i] -= constraints[i].guess[position] == color;
+    }
+}
+
+std::uint8_t Counter::nb_free_irrelevant_colors(size_t position) const {
+    return static_cast<std::uint8_t>(nb_irrelevant_colors - (position - used.count()));
+}
+
+bool Counter::is_feasible(size_t remaining) const {
+    for (size_t i = 0; i < constraints.size(); ++i) {
+        const Constraint& constraint = constraints[i];
+        const std::uint8_t total = compare_and_count(used, constraint.guess_frequency_map);
+        if (blacks[i] > constraint.black || blacks[i] + remaining < constraint.black
+            || total > constraint.total || total + remaining < constraint.total) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Counter::is_consistent() const {
+    return is_feasible(0);
+}
+
+std::uint64_t Counter::count_from(size_t position) {
+    if (position == pegs) {
+        return is_consistent() ? 1 : 0;
+    }
+
+    auto key = std::make_tuple(blacks, used.to_ulong());
+    auto& position_memo = memo[position];
+    if (const auto it = position_memo.find(key); it != position_memo.end()) {
+        return it->second;
+    }
+
+    const size_t remaining = pegs - position - 1;
+    std::uint64_t count = 0;
+    for (Color color : relevant_colors) {
+        if (used.test(color)) {
+            continue;
+        }
+
+        place(color, position);
+        if (is_feasible(remaining)) {
+            count = saturating_add(count, count_from(position + 1));
+        }
+        unplace(color, position);
+    }
+
+    // Colors absent from every guess cannot change any feedback
+    const std::uint8_t nb_free = nb_free_irrelevant_colors(position);
+    if (nb_free != 0 && is_feasible(remaining)) {
+        count = saturating_add(count, saturating_multiply(nb_free, count_from(position + 1)));
+    }
+
+    position_memo.emplace(std::move(key), count);
+    return count;
+}
+
+const std::vector<std::uint64_t>& Counter::partition_from(size_t position) {
+    if (position == pegs) {
+        return is_consistent() ? consistent_leaf : inconsistent_leaf;
+    }
+
+    auto key = std::make_tuple(blacks, used.to_ulong());
+    auto& position_memo = partition_memo[position];
+    if (const auto it = position_memo.find(key); it != position_memo.end()) {
+        return it->second;
+    }
+
+    // Histogram of the black and black + white pegs the suffix adds to the probed guess
+    const size_t stride = pegs + 1;
+    const size_t remaining = pegs - position - 1;
+    std::vector<std::uint64_t> histogram(stride * stride, 0);
+    for (Color color : relevant_colors) {
+        if (used.test(color)) {
+            continue;
+        }
+
+        const size_t black = probe[position] == color;
+        const size_t total = probe_frequency_map.test(color);
+        place(color, position);
+        if (is_feasible(remaining)) {
+            const auto& child = partition_from(position + 1);
+            for (size_t b = 0; b + black <= pegs; ++b) {
+                for (size_t t = 0; t + total <= pegs; ++t) {
+                    auto& nb_codes = histogram[(b + black) * stride + t + total];
+                    nb_codes = saturating_add(nb_codes, child[b * stride + t]);
+                }
+            }
+        }
+        unplace(color, position);
+    }
+
+    // Colors absent from every guess cannot change any feedback
+    const std::uint8_t nb_free = nb_free_irrelevant_colors(position);
+    if (nb_free != 0 && is_feasible(remaining)) {
+        const auto& child = partition_from(position + 1);
+        for (size_t i = 0; i < histogram.size(); ++i) {
+            histogram[i] = saturating_add(histogram[i], saturating_multiply(nb_free, child[i]));
+        }
+    }
+
+    return position_memo.emplace(std::move(key), std::move(histogram)).first->second;
+}
+
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <tuple>
+#include <vector>
+
+#include "Code.h"
+#include "Feedback.h"
+#include "NoDuplicateSolver.h"
+
+
+namespace no_duplicate {
+
+// Counter: counts the codes without duplicates consistent with a set of (guess, feedback)
+// constraints without enumerating them. Memoization is done per position on the black pegs
+// of every constraint and on the set of used colors appearing in any guess.
+class Counter {
+    struct Constraint {
+        Code guess;
+        FrequencyMap guess_frequency_map;
+        std::uint8_t black;
+        std::uint8_t total;
+    };
+
+    const std::uint8_t pegs;
+    const std::uint8_t colors;
+    std::vector<Constraint> constraints;
+    std::vector<Color> relevant_colors;
+    std::uint8_t nb_irrelevant_colors;
+
+    std::vector<std::uint8_t> blacks;
+    FrequencyMap used;
+    std::vector<std::map<std::tuple<std::vector<std::uint8_t>, unsigned long>, std::uint64_t>> memo;
+
+    Code probe;
+    FrequencyMap probe_frequency_map;
+    std::vector<std::uint64_t> consistent_leaf;
+    std::vector<std::uint64_t> inconsistent_leaf;
+    std::vector<std::map<std::tuple<std::vector<std::uint8_t>, unsigned long>, std::vector<std::uint64_t>>> partition_memo;
+
+public:
+    Counter(std::uint8_t pegs, std::uint8_t colors);
+
+    void add_constraint(const Code& guess, const FrequencyMap& guess_frequency_map, const Feedback& feedback);
+
+    // Exact number of consistent codes, saturated at the largest std::uint64_t
+    std::uint64_t count();
+
+    // Knuth's random probe estimate of the number of consistent codes, for boards too large to count
+    double estimate(unsigned int nb_probes, unsigned int seed);
+
+    // Number of consistent codes giving each feedback to the guess, indexed by black * (pegs + 1) + white, saturated as count
+    std::vector<std::uint64_t> partition(const Code& guess, const FrequencyMap& guess_frequency_map);
+
+private:
+    void prepare(const FrequencyMap& extra_colors = {});
+
+    void place(Color color, size_t position);
+    void unplace(Color color, size_t position);
+    std::uint8_t nb_free_irrelevant_colors(size_t position) const;
+    bool is_feasible(size_t remaining) const;
+    bool is_consistent() const;
+
+    std::uint64_t count_from(size_t position);
+    const std::vector<std::uint64_t>& partition_from(size_t position);
+};
+
+}
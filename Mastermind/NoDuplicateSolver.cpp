@@ -1,10 +1,30 @@
 #include "NoDuplicateSolver.h"
+#include "NoDuplicateCounter.h"
+#include "Serialization.h"
+#include "Trace.h"
 #include <algorithm>
+#include <array>
 #include <ranges>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
 
 
 namespace no_duplicate {
 
+namespace {
+
+constexpr std::array<char, 4> checkpoint_magic{ 'M', 'M', 'C', 'N' };
+constexpr std::uint8_t checkpoint_version = 1;
+// Far above the guesses of any game, bounds the history read back from a checkpoint
+constexpr std::uint32_t max_history_size = 1 << 16;
+
+std::generator<SearchState> exhausted_search() {
+    co_return;
+}
+
+}
+
 FeedbackCalculator::FeedbackCalculator(std::uint8_t pegs)
     : pegs(pegs)
 {}
@@ -33,56 +53,325 @@ FeedbackCalculator::FeedbackCalculator(std::uint8_t pegs, const Code& secret) :
 Solver::Solver(std::uint8_t pegs, std::uint8_t colors)
     : pegs(pegs)
     , colors(colors)
+    , check_orders(pegs)
     , code(pegs, 0)
-    , converted_code(pegs, 0)
+    , code_planes((pegs + positions_per_word - 1) / positions_per_word, 0)
     , position(0)
     , last_position(pegs - 1)
     , all_colors_known_mode(false)
-    , color_map(colors)
+    , permutation_engine(pegs)
     , code_gen(backtrack())
     , code_it(code_gen.begin())
+    , search_pending(true)
+    , partial_guess_played(false)
+    , partial_code(pegs, 0)
     , feedback_calculator(pegs)
+    , game_trace(nullptr)
 {}
 
+Solver::Solver(std::uint8_t pegs, std::uint8_t colors, std::span<const GameTrace::Move> moves)
+    : Solver(pegs, colors) {
+    Code guess(pegs, 0);
+    FrequencyMap guess_frequency_map;
+    for (const auto& [move_guess, feedback, checkpoint] : moves) {
+        std::ranges::copy(move_guess, guess.begin());
+        guess_frequency_map.reset();
+        for (Color color : move_guess) {
+            guess_frequency_map.set(color);
+        }
+        add_to_history(guess, guess_frequency_map, feedback);
+    }
+}
+
+void Solver::set_game_trace(GameTrace* game_trace) {
+    this->game_trace = game_trace;
+}
+
 FeedbackCalculator& Solver::get_feedback_calculator() {
     return feedback_calculator;
 }
 
 std::tuple<const Code&, const FrequencyMap&> Solver::next_guess() {
-    if (all_colors_known_mode) {
-        converted_code_frequency_map.reset();
-        for (size_t i = 0; i < pegs; ++i) {
-            const Color converted_color = color_map[code[i]];
-            converted_code[i] = converted_color;
-            converted_code_frequency_map.flip(converted_color);
-        }
+    TRACE_SCOPE("next_guess");
+    resume_search(SearchBudget{});
+    partial_guess_played = false;
+    return { code, code_frequency_map };
+}
 
-        return { converted_code, converted_code_frequency_map };
+std::tuple<const Code&, const FrequencyMap&, GuessQuality> Solver::next_guess(const SearchBudget& search_budget) {
+    TRACE_SCOPE("next_guess");
+    const auto search_state = resume_search(search_budget);
+    if (!search_state) {
+        partial_guess_played = false;
+        return { code, code_frequency_map, GuessQuality::no_candidate };
     }
-    else {
-        return { code, code_frequency_map };
+    if (*search_state == SearchState::found) {
+        partial_guess_played = false;
+        return { code, code_frequency_map, GuessQuality::consistent };
     }
+
+    make_partial_guess();
+    partial_guess_played = true;
+    return { partial_code, partial_code_frequency_map, GuessQuality::partial };
 }
 
 void Solver::apply_feedback(const Feedback& feedback) {
-    history.emplace(feedback, History{ code, code_frequency_map });
+    TRACE_SCOPE("apply_feedback");
+    const Code& guess = partial_guess_played ? partial_code : code;
+    const FrequencyMap& guess_frequency_map = partial_guess_played ? partial_code_frequency_map : code_frequency_map;
+    partial_guess_played = false;
+
+    if (game_trace) {
+        game_trace->add_move(guess, feedback);
+    }
+
+    add_to_history(guess, guess_frequency_map, feedback);
+
+    // The replay resumes the search from here, as the game did
+    if (game_trace) {
+        std::ostringstream checkpoint(std::ios::binary);
+        save(checkpoint);
+        game_trace->set_checkpoint(std::move(checkpoint).str());
+    }
+}
+
+void Solver::add_to_history(const Code& guess, const FrequencyMap& guess_frequency_map, const Feedback& feedback) {
+    const auto& entry = *history.emplace(feedback, History{ guess, guess_frequency_map, make_position_planes(guess, pegs) });
+    for (auto& check_order : check_orders) {
+        check_order.add(entry);
+    }
 
+    if (all_colors_known_mode) {
+        permutation_engine.add_constraint(guess, static_cast<std::uint8_t>(feedback.black()));
+    }
     // Check if we should switch to permutation mode
-    if (!all_colors_known_mode && feedback.black() + feedback.white() == pegs) {
+    else if (feedback.black() + feedback.white() == pegs) {
+        TRACE_INSTANT("all_colors_known_mode");
         all_colors_known_mode = true;
-        code_gen = backtrack_using_only_code_colors();
+        permutation_engine.reset(guess);
+        for (const auto& [old_guess_feedback, data] : history) {
+            const auto& [old_guess, old_guess_frequency_map, old_guess_planes] = data;
+            permutation_engine.add_constraint(old_guess, static_cast<std::uint8_t>(old_guess_feedback.black()));
+        }
+
+        // The frequency map is the one of the known colors and stays so for every arrangement
+        code_frequency_map = guess_frequency_map;
+        code_gen = backtrack_permutations();
         code_it = code_gen.begin();
-        return;
     }
 
-    ++code_it;
+    search_pending = true;
 }
 
 bool Solver::can_continue() const {
     return code_it != code_gen.end();
 }
 
-std::generator<Solver::NewValue> Solver::backtrack() {
+std::uint64_t Solver::count_consistent() const {
+    return make_counter().count();
+}
+
+double Solver::estimate_consistent(unsigned int nb_probes, unsigned int seed) const {
+    return make_counter().estimate(nb_probes, seed);
+}
+
+Counter Solver::make_counter() const {
+    Counter counter(pegs, colors);
+    for (const auto& [old_guess_feedback, data] : history) {
+        const auto& [old_guess, old_guess_frequency_map, old_guess_planes] = data;
+        counter.add_constraint(old_guess, old_guess_frequency_map, old_guess_feedback);
+    }
+    return counter;
+}
+
+const std::vector<Solver::HistoryCheck>& Solver::get_check_order(size_t position) const {
+    return check_orders[position].get_checks();
+}
+
+void Solver::save(std::ostream& stream) const {
+    stream.write(checkpoint_magic.data(), checkpoint_magic.size());
+    write_value<std::uint8_t>(stream, checkpoint_version);
+    write_value<std::uint8_t>(stream, pegs);
+    write_value<std::uint8_t>(stream, colors);
+
+    // History in the order of the multimap, the check orders refer to the entries by their index in it
+    write_value<std::uint32_t>(stream, static_cast<std::uint32_t>(history.size()));
+    for (const auto& [old_guess_feedback, data] : history) {
+        const auto& [old_guess, old_guess_frequency_map, old_guess_planes] = data;
+        stream.write(reinterpret_cast<const char*>(old_guess.data()), pegs);
+        write_value<std::uint8_t>(stream, static_cast<std::uint8_t>(old_guess_feedback.black()));
+        write_value<std::uint8_t>(stream, static_cast<std::uint8_t>(old_guess_feedback.white()));
+    }
+
+    for (const auto& check_order : check_orders) {
+        write_value<std::uint64_t>(stream, check_order.get_nb_nodes_until_reorder());
+        for (const auto& [entry, nb_checks, nb_rejections] : check_order.get_checks()) {
+            const auto it = std::ranges::find_if(history, [&](const auto& h) { return &h == entry; });
+            write_value<std::uint32_t>(stream, static_cast<std::uint32_t>(std::ranges::distance(history.begin(), it)));
+            write_value<std::uint64_t>(stream, nb_checks);
+            write_value<std::uint64_t>(stream, nb_rejections);
+        }
+    }
+
+    // Search state, the peg stack is the code up to the position
+    stream.write(reinterpret_cast<const char*>(code.data()), pegs);
+    write_value<std::uint32_t>(stream, static_cast<std::uint32_t>(code_frequency_map.to_ulong()));
+    write_value<std::uint32_t>(stream, static_cast<std::uint32_t>(position));
+    write_value<bool>(stream, all_colors_known_mode);
+    write_value<bool>(stream, search_pending);
+    write_value<bool>(stream, code_it == code_gen.end());
+    write_value<bool>(stream, partial_guess_played);
+    stream.write(reinterpret_cast<const char*>(partial_code.data()), pegs);
+    write_value<std::uint32_t>(stream, static_cast<std::uint32_t>(partial_code_frequency_map.to_ulong()));
+    permutation_engine.save(stream);
+}
+
+void Solver::load(std::istream& stream) {
+    std::array<char, 4> magic{};
+    stream.read(magic.data(), magic.size());
+    if (!stream || magic != checkpoint_magic || read_value<std::uint8_t>(stream) != checkpoint_version) {
+        throw std::runtime_error("Not a checkpoint of a no duplicate solver");
+    }
+    if (read_value<std::uint8_t>(stream) != pegs || read_value<std::uint8_t>(stream) != colors) {
+        throw std::runtime_error("Checkpoint saved with other pegs or colors");
+    }
+
+    // Everything is read into locals and checked first, the solver is only changed once the whole checkpoint is valid
+    const auto history_size = read_value<std::uint32_t>(stream);
+    if (!stream || history_size > max_history_size) {
+        throw std::runtime_error("Truncated or corrupted checkpoint");
+    }
+    decltype(history) loaded_history;
+    std::vector<const HistoryEntry*> entries(history_size);
+    Code guess(pegs, 0);
+    FrequencyMap guess_frequency_map;
+    for (auto& entry : entries) {
+        stream.read(reinterpret_cast<char*>(guess.data()), pegs);
+        const auto black = read_value<std::uint8_t>(stream);
+        const auto white = read_value<std::uint8_t>(stream);
+        if (black + white > pegs) {
+            throw std::runtime_error("Corrupted checkpoint");
+        }
+        guess_frequency_map.reset();
+        for (Color color : guess) {
+            if (color >= colors) {
+                throw std::runtime_error("Corrupted checkpoint");
+            }
+            guess_frequency_map.set(color);
+        }
+        entry = &*loaded_history.emplace(Feedback{ black, white }, History{ guess, guess_frequency_map, make_position_planes(guess, pegs) });
+    }
+
+    // Each position checks every entry once, an entry left out would let inconsistent codes through
+    std::vector<std::uint64_t> nb_nodes_until_reorder(check_orders.size());
+    std::vector<std::vector<HistoryCheck>> loaded_checks(check_orders.size(), std::vector<HistoryCheck>(entries.size()));
+    for (size_t i = 0; i < check_orders.size(); ++i) {
+        nb_nodes_until_reorder[i] = read_value<std::uint64_t>(stream);
+        std::vector<bool> is_checked(entries.size(), false);
+        for (auto& [entry, nb_checks, nb_rejections] : loaded_checks[i]) {
+            const auto index = read_value<std::uint32_t>(stream);
+            if (index >= entries.size() || is_checked[index]) {
+                throw std::runtime_error("Corrupted checkpoint");
+            }
+            is_checked[index] = true;
+            entry = entries[index];
+            nb_checks = read_value<std::uint64_t>(stream);
+            nb_rejections = read_value<std::uint64_t>(stream);
+        }
+    }
+
+    Code loaded_code = code;
+    Code loaded_partial_code = partial_code;
+    PermutationEngine loaded_permutation_engine(pegs);
+    stream.read(reinterpret_cast<char*>(loaded_code.data()), pegs);
+    const FrequencyMap loaded_code_frequency_map(read_value<std::uint32_t>(stream));
+    const size_t loaded_position = read_value<std::uint32_t>(stream);
+    const bool loaded_all_colors_known_mode = read_value<bool>(stream);
+    const bool loaded_search_pending = read_value<bool>(stream);
+    const bool exhausted = read_value<bool>(stream);
+    const bool loaded_partial_guess_played = read_value<bool>(stream);
+    stream.read(reinterpret_cast<char*>(loaded_partial_code.data()), pegs);
+    const FrequencyMap loaded_partial_code_frequency_map(read_value<std::uint32_t>(stream));
+    loaded_permutation_engine.load(stream, colors);
+
+    if (!stream || loaded_position > last_position) {
+        throw std::runtime_error("Truncated or corrupted checkpoint");
+    }
+
+    // The search builds the planes from the colors of the code. The pegs before the position are placed,
+    // the one at the position and the ones after it may be one past the last color.
+    // The frequency map of the partial code is only built along with a partial guess.
+    FrequencyMap partial_code_recount;
+    for (size_t i = 0; i < pegs; ++i) {
+        if (loaded_code[i] > colors || (i < loaded_position && loaded_code[i] == colors) || loaded_partial_code[i] >= colors) {
+            throw std::runtime_error("Corrupted checkpoint");
+        }
+        partial_code_recount.set(loaded_partial_code[i]);
+    }
+    if ((loaded_code_frequency_map >> colors).any()
+        || (loaded_partial_guess_played && loaded_partial_code_frequency_map != partial_code_recount)) {
+        throw std::runtime_error("Corrupted checkpoint");
+    }
+
+    // The entries stay where they are when the histories are swapped, the checks keep pointing to them
+    history.swap(loaded_history);
+    for (size_t i = 0; i < check_orders.size(); ++i) {
+        check_orders[i].restore(std::move(loaded_checks[i]), nb_nodes_until_reorder[i]);
+    }
+    code = std::move(loaded_code);
+    code_frequency_map = loaded_code_frequency_map;
+    position = loaded_position;
+    all_colors_known_mode = loaded_all_colors_known_mode;
+    search_pending = loaded_search_pending;
+    partial_guess_played = loaded_partial_guess_played;
+    partial_code = std::move(loaded_partial_code);
+    partial_code_frequency_map = loaded_partial_code_frequency_map;
+    permutation_engine.swap(loaded_permutation_engine);
+
+    // The search keeps all its state in the members, a new coroutine picks it up where the saved one stopped
+    code_gen = exhausted ? exhausted_search()
+        : all_colors_known_mode ? backtrack_permutations()
+        : backtrack();
+    code_it = code_gen.begin();
+}
+
+std::optional<SearchState> Solver::resume_search(const SearchBudget& search_budget) {
+    // A finished search is never resumed, later feedbacks cannot bring codes back
+    if (code_it == code_gen.end()) {
+        search_pending = false;
+        return std::nullopt;
+    }
+    if (!search_pending) {
+        return SearchState::found;
+    }
+
+    TRACE_SCOPE("backtrack_resume");
+    budget = search_budget;
+    ++code_it;
+    if (code_it == code_gen.end()) {
+        search_pending = false;
+        return std::nullopt;
+    }
+    if (*code_it == SearchState::interrupted) {
+        return SearchState::interrupted;
+    }
+
+    search_pending = false;
+    return SearchState::found;
+}
+
+std::generator<SearchState> Solver::backtrack() {
+    // Suspended until a guess is asked for, so that the whole search runs within next_guess
+    co_yield SearchState::interrupted;
+
+    // The frequency map and the planes hold the pegs placed before the position, the search may resume a checkpoint
+    code_frequency_map.reset();
+    std::ranges::fill(code_planes, 0);
+    for (size_t i = 0; i < position; ++i) {
+        code_frequency_map.set(code[i]);
+        code_planes[i / positions_per_word] |= position_bit(i, code[i]);
+    }
+
     while (true) {
         const Color color = code[position];
         if (color >= colors) {
@@ -90,37 +379,43 @@ std::generator<Solver::NewValue> Solver::backtrack() {
                 break;
             }
 
-            code_frequency_map.flip(code[--position]);
+            // Polled when backtracking only, the nodes in between are at most the colors of each position
+            if (budget.is_expired()) {
+                co_yield SearchState::interrupted;
+            }
+
+            --position;
+            toggle_peg(code[position]);
         }
         else {
             if (!code_frequency_map.test(color)) {
-                code_frequency_map.flip(color);
+                toggle_peg(color);
 
                 if (position == last_position) {
-                    if (std::ranges::all_of(history, [&](const auto& h) {
+                    if (check_orders[position].all_of([&](const auto& h) {
                         const auto& [old_guess_feedback, data] = h;
-                        const auto& [old_guess, old_guess_frequency_map] = data;
-                        return is_same_feedback(old_guess, old_guess_feedback, old_guess_frequency_map);
+                        const auto& [old_guess, old_guess_frequency_map, old_guess_planes] = data;
+                        return is_same_feedback(old_guess_planes, old_guess_feedback, old_guess_frequency_map);
                         })) {
 
-                        co_yield{};
+                        co_yield SearchState::found;
                     }
 
-                    code_frequency_map.flip(color);
+                    toggle_peg(color);
                 }
                 else {
                     // Partial code pruning
-                    if (std::ranges::all_of(history, [&](const auto& h) {
+                    if (check_orders[position].all_of([&](const auto& h) {
                         const auto& [old_guess_feedback, data] = h;
-                        const auto& [old_guess, old_guess_frequency_map] = data;
-                        return is_similar_feedback(old_guess, old_guess_feedback, old_guess_frequency_map);
+                        const auto& [old_guess, old_guess_frequency_map, old_guess_planes] = data;
+                        return is_similar_feedback(old_guess_planes, old_guess_feedback, old_guess_frequency_map);
 
                         })) {
                         code[++position] = 0;
                         continue;
                     }
                     else {
-                        code_frequency_map.flip(color);
+                        toggle_peg(color);
                     }
                 }
             }
@@ -130,56 +425,92 @@ std::generator<Solver::NewValue> Solver::backtrack() {
     }
 }
 
-std::generator<Solver::NewValue> Solver::backtrack_using_only_code_colors() {
-    create_color_map();
-    convert_code_and_history();
+std::generator<SearchState> Solver::backtrack_permutations() {
+    // Suspended until a guess is asked for, so that the whole search runs within next_guess
+    co_yield SearchState::interrupted;
 
-    colors = pegs;
-
-    // Free last color
-    code_frequency_map.flip(code[position]);
-
-    return backtrack();
+    while (const auto state = permutation_engine.next(code, budget)) {
+        co_yield *state;
+    }
 }
 
-void Solver::create_color_map() {
-    std::ranges::copy(code.begin(), code.begin() + pegs, color_map.begin());
-    std::ranges::sort(color_map.begin(), color_map.begin() + pegs);
-
-    Color c = 0;
-    size_t j = 0;
-    for (size_t i = pegs; i < colors; ++i) {
-        // Find next missing color
-        while (j < pegs && color_map[j] <= c) {
-            ++c;
-            ++j;
+void Solver::make_partial_guess() {
+    if (all_colors_known_mode) {
+        // An arrangement of the known colors, from the pegs the permutation engine placed so far
+        permutation_engine.write_frontier(partial_code);
+        partial_code_frequency_map.reset();
+        for (const Color color : partial_code) {
+            partial_code_frequency_map.set(color);
         }
-
-        color_map[i] = c++;
     }
-}
-
-void convert_inplace_code_and_frequency_map(Code& code, FrequencyMap& code_frequency_map, const std::vector<Color>& reverse_color_map) {
-    // This is faster than setting all colors in code to false since the values are compacted in a bitset
-    code_frequency_map.reset();
+    else {
+        // The prefix placed so far agrees with every history entry, the rest is left over from the previous branches
+        // and duplicated or out of range colors are replaced by the first unused ones
+        partial_code_frequency_map.reset();
+        for (size_t i = 0; i < pegs; ++i) {
+            const Color color = code[i];
+            if (color < colors && !partial_code_frequency_map.test(color)) {
+                partial_code[i] = color;
+                partial_code_frequency_map.set(color);
+            }
+            else {
+                partial_code[i] = colors;
+            }
+        }
 
-    for (Color& color : code) {
-        color = reverse_color_map[color];
-        code_frequency_map.flip(color);
+        Color unused = 0;
+        for (Color& color : partial_code) {
+            if (color == colors) {
+                while (partial_code_frequency_map.test(unused)) {
+                    ++unused;
+                }
+                color = unused;
+                partial_code_frequency_map.set(color);
+            }
+        }
     }
-}
 
-void Solver::convert_code_and_history() {
-    std::vector<Color> reverse_color_map(colors, 0);
-    for (const auto [i, c] : std::views::enumerate(color_map)) {
-        reverse_color_map[c] = static_cast<Color>(i);
-    }
+    // A code already played would only give its feedback again, the next codes in lexicographic order are
+    // tried instead, arrangements of the same colors when those are known. No more codes than entries were
+    // played, so one of that many next codes was not unless the arrangements run out.
+    const auto is_played = [&]() {
+        return std::ranges::any_of(history, [&](const auto& h) {
+            const auto& [old_guess_feedback, data] = h;
+            const auto& [old_guess, old_guess_frequency_map, old_guess_planes] = data;
+            return old_guess == partial_code;
+            });
+    };
+    for (size_t i = 0; i < history.size() && is_played(); ++i) {
+        if (all_colors_known_mode) {
+            std::ranges::next_permutation(partial_code);
+            continue;
+        }
+
+        // The last peg that can take a larger unused color does, the pegs after it take the smallest unused ones.
+        // Past the last code every peg is after it and the first code comes next.
+        size_t peg = pegs;
+        while (peg-- > 0) {
+            partial_code_frequency_map.reset(partial_code[peg]);
+            Color color = partial_code[peg] + 1;
+            while (color < colors && partial_code_frequency_map.test(color)) {
+                ++color;
+            }
+            if (color < colors) {
+                partial_code[peg] = color;
+                partial_code_frequency_map.set(color);
+                break;
+            }
+        }
 
-    convert_inplace_code_and_frequency_map(code, code_frequency_map, reverse_color_map);
-    for (auto& [old_guess_feedback, data] : history) {
-        auto& [old_guess, old_guess_frequency_map] = data;
-        convert_inplace_code_and_frequency_map(old_guess, old_guess_frequency_map, reverse_color_map);
+        Color unused = 0;
+        for (size_t j = peg + 1; j < pegs; ++j) {
+            while (partial_code_frequency_map.test(unused)) {
+                ++unused;
+            }
+            partial_code[j] = unused;
+            partial_code_frequency_map.set(unused);
+        }
     }
 }
 
-}
\ No newline at end of file
+}
@@ -2,13 +2,21 @@
 
 #include <bitset>
 #include <generator>
+#include <istream>
 #include <map>
+#include <optional>
+#include <ostream>
+#include <span>
 #include <tuple>
 #include <vector>
 
 
+#include "CheckOrder.h"
 #include "Code.h"
 #include "Feedback.h"
+#include "GameTrace.h"
+#include "PermutationEngine.h"
+#include "SearchBudget.h"
 
 
 namespace no_duplicate {
@@ -21,7 +29,29 @@ static inline std::uint8_t compare_and_count(const FrequencyMap& lhs, const Freq
     return std::popcount((lhs & rhs).to_ulong());
 }
 
-using History = std::tuple<Code, FrequencyMap>;
+// Codes as one-hot position planes: each position is a lane of bitset_size bits with only the bit of
+// its color set, two lanes to a word. Without duplicates the black pegs are the bits two codes share.
+static constexpr size_t positions_per_word = 64 / bitset_size;
+using PositionPlanes = std::vector<std::uint64_t>;
+
+static inline std::uint64_t position_bit(size_t position, Color color) {
+    return std::uint64_t{ 1 } << ((position % positions_per_word) * bitset_size + color);
+}
+
+// Places the peg of the color at the position, or removes it once placed
+static inline void toggle_peg(PositionPlanes& planes, size_t position, Color color) {
+    planes[position / positions_per_word] ^= position_bit(position, color);
+}
+
+static inline PositionPlanes make_position_planes(const Code& code, size_t pegs) {
+    PositionPlanes planes((pegs + positions_per_word - 1) / positions_per_word, 0);
+    for (size_t i = 0; i < pegs; ++i) {
+        planes[i / positions_per_word] |= position_bit(i, code[i]);
+    }
+    return planes;
+}
+
+using History = std::tuple<Code, FrequencyMap, PositionPlanes>;
 
 
 
@@ -35,6 +65,15 @@ static inline std::uint8_t count_black_pegs(const Code& code, const Code& old_gu
     return black;
 }
 
+// The planes of the code hold the pegs up to the position only
+static inline std::uint8_t count_black_pegs(const PositionPlanes& code_planes, const PositionPlanes& old_guess_planes, size_t position) {
+    std::uint8_t black = 0;
+    for (size_t i = 0; i <= position / positions_per_word; ++i) {
+        black += static_cast<std::uint8_t>(std::popcount(code_planes[i] & old_guess_planes[i]));
+    }
+    return black;
+}
+
 
 static inline std::uint8_t count_white_pegs(const FrequencyMap& code_frequency_map,
     const FrequencyMap& old_guess_frequency_map,
@@ -61,44 +100,88 @@ public:
 
 
 
+class Counter;
+
 class Solver {
-    struct NewValue {};
+public:
+    using HistoryEntry = std::pair<const Feedback, History>;
+    using HistoryCheck = CheckOrder<HistoryEntry>::Check;
 
+private:
     const std::uint8_t pegs;
-    std::uint8_t colors;
+    const std::uint8_t colors;
     std::multimap<Feedback, History, std::greater<>> history;
+    std::vector<CheckOrder<HistoryEntry>> check_orders;
     FrequencyMap code_frequency_map;
     Code code;
-    FrequencyMap converted_code_frequency_map;
-    Code converted_code;
+    PositionPlanes code_planes;
     size_t position;
     const size_t last_position;
     bool all_colors_known_mode;
-    std::vector<Color> color_map;
-    std::generator<NewValue> code_gen;
+    PermutationEngine permutation_engine;
+    std::generator<SearchState> code_gen;
     decltype(code_gen.begin()) code_it;
+    SearchBudget budget;
+    bool search_pending;
+    bool partial_guess_played;
+    FrequencyMap partial_code_frequency_map;
+    Code partial_code;
     FeedbackCalculator feedback_calculator;
+    GameTrace* game_trace;
 
 public:
+    // Boards the solver handles: every peg takes another color and the frequency maps hold bitset_size colors
+    static constexpr bool supports(std::uint8_t pegs, std::uint8_t colors) {
+        return pegs != 0 && pegs <= colors && colors <= bitset_size;
+    }
+
     Solver(std::uint8_t pegs, std::uint8_t colors);
 
+    // Solver at the state reached after the moves, the search restarts from the first code
+    Solver(std::uint8_t pegs, std::uint8_t colors, std::span<const GameTrace::Move> moves);
+
+    // Records every guess and its feedback in the trace with a checkpoint of the solver, pass nullptr to stop recording
+    void set_game_trace(GameTrace* game_trace);
+
     FeedbackCalculator& get_feedback_calculator();
 
+    // Searches without a budget. Once no code is left can_continue() turns false and the guess is not to be played.
     std::tuple<const Code&, const FrequencyMap&> next_guess();
 
+    // Anytime variant: searches for at most the budget. Returns the first consistent code, or when interrupted
+    // a best effort guess built from the search frontier; the search resumes at the next call.
+    // No guess is to be played when no code is left.
+    std::tuple<const Code&, const FrequencyMap&, GuessQuality> next_guess(const SearchBudget& search_budget);
+
     void apply_feedback(const Feedback& feedback);
 
+    // False once a search has run out of codes, the feedbacks contradict each other. Never searches itself,
+    // a contradiction is only known after the next guess was asked for.
     bool can_continue() const;
 
+    // Exact number of codes consistent with the history, saturated at the largest std::uint64_t
+    std::uint64_t count_consistent() const;
+
+    // Estimate of the number of codes consistent with the history, for boards too large to count
+    double estimate_consistent(unsigned int nb_probes, unsigned int seed) const;
+
+    // Order in which the history entries are checked when placing a peg at the position, as learned so far
+    const std::vector<HistoryCheck>& get_check_order(size_t position) const;
+
+    // Checkpoint of the game and of the search, a solver loading it goes on exactly where the saved one stopped.
+    // Throws std::runtime_error if the checkpoint is truncated or was saved with other settings.
+    void save(std::ostream& stream) const;
+    void load(std::istream& stream);
+
 private:
     template<typename Pred>
         requires std::predicate<Pred, std::uint8_t, std::uint8_t>
-    inline bool compare_feedback(const Code& old_guess,
+    inline bool compare_feedback(const PositionPlanes& old_guess_planes,
         const Feedback& old_guess_feedback,
         const FrequencyMap& old_guess_frequency_map,
         Pred pred) {
         // Black pegs
-        const std::uint8_t black = count_black_pegs(code, old_guess, position);
+        const std::uint8_t black = count_black_pegs(code_planes, old_guess_planes, position);
         if (!pred(black, old_guess_feedback.black())) {
             return false;
         }
@@ -108,20 +191,29 @@ private:
         return pred(white, old_guess_feedback.white());
     }
 
-    inline bool is_same_feedback(const Code& old_guess, const Feedback& old_guess_feedback, const FrequencyMap& old_guess_frequency_map) {
-        return compare_feedback(old_guess, old_guess_feedback, old_guess_frequency_map, std::equal_to<std::uint8_t>{});
+    inline bool is_same_feedback(const PositionPlanes& old_guess_planes, const Feedback& old_guess_feedback, const FrequencyMap& old_guess_frequency_map) {
+        return compare_feedback(old_guess_planes, old_guess_feedback, old_guess_frequency_map, std::equal_to<std::uint8_t>{});
+    }
+
+    inline bool is_similar_feedback(const PositionPlanes& old_guess_planes, const Feedback& old_guess_feedback, const FrequencyMap& old_guess_frequency_map) {
+        return compare_feedback(old_guess_planes, old_guess_feedback, old_guess_frequency_map, std::less_equal<std::uint8_t>{});
     }
 
-    inline bool is_similar_feedback(const Code& old_guess, const Feedback& old_guess_feedback, const FrequencyMap& old_guess_frequency_map) {
-        return compare_feedback(old_guess, old_guess_feedback, old_guess_frequency_map, std::less_equal<std::uint8_t>{});
+    // Places the peg of the color at the position, or removes it once placed
+    inline void toggle_peg(Color color) {
+        code_frequency_map.flip(color);
+        no_duplicate::toggle_peg(code_planes, position, color);
     }
 
 
-    std::generator<NewValue> backtrack();
-    std::generator<NewValue> backtrack_using_only_code_colors();
+    Counter make_counter() const;
+    void add_to_history(const Code& guess, const FrequencyMap& guess_frequency_map, const Feedback& feedback);
+    // Empty once no code is left
+    std::optional<SearchState> resume_search(const SearchBudget& search_budget);
+    void make_partial_guess();
 
-    void create_color_map();
-    void convert_code_and_history();
+    std::generator<SearchState> backtrack();
+    std::generator<SearchState> backtrack_permutations();
 };
 
 }
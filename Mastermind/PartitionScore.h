@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "DuplicateSolver.h"
+
+
+namespace duplicate {
+
+// Sum of the squared sizes of the partitions of the codes by their feedback to the guess,
+// the expected number of codes left after playing it times the number of codes
+inline std::uint64_t partition_score(const History& guess, std::span<const History> codes, std::uint8_t pegs, std::uint8_t colors,
+    std::vector<std::uint32_t>& partition_sizes) {
+    partition_sizes.assign((pegs + 1) * (pegs + 1), 0);
+    for (const auto& code : codes) {
+        const std::uint8_t black = count_black_pegs(guess.get_code(), code.get_code(), pegs - 1);
+        const std::uint8_t white = count_white_pegs(guess.get_frequency_map(), code.get_frequency_map(), colors, black);
+        ++partition_sizes[black * (pegs + 1) + white];
+    }
+
+    std::uint64_t score = 0;
+    for (const std::uint64_t size : partition_sizes) {
+        score += size * size;
+    }
+    return score;
+}
+
+}
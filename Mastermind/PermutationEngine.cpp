@@ -0,0 +1,188 @@
+#include "PermutationEngine.h"
+#include "Serialization.h"
+#include <algorithm>
+#include <functional>
+#include <numeric>
+#include <ranges>
+#include <stdexcept>
+#include <utility>
+
+
+namespace {
+
+// Far above the guesses of any game, bounds the number of constraints read back
+constexpr std::uint32_t max_nb_constraints = 1 << 16;
+
+}
+
+
+PermutationEngine::PermutationEngine(std::uint8_t pegs)
+    : pegs(pegs)
+    , last_position(pegs - 1)
+    , slots(pegs, 0)
+    , position(0)
+{
+    if (pegs > max_pegs) {
+        throw std::invalid_argument("Too many pegs for the permutation engine");
+    }
+}
+
+void PermutationEngine::reset(const Code& code) {
+    known_colors.assign(code.begin(), code.begin() + pegs);
+    std::ranges::sort(known_colors);
+
+    remaining.clear();
+    for (auto it = known_colors.begin(); it != known_colors.end();) {
+        const auto next = std::ranges::find_if(it, known_colors.end(), [&](Color color) { return color != *it; });
+        remaining.push_back(static_cast<std::uint8_t>(next - it));
+        it = next;
+    }
+    known_colors.erase(std::unique(known_colors.begin(), known_colors.end()), known_colors.end());
+
+    feasible_positions.assign(known_colors.size(), (pegs == max_pegs ? ~std::uint64_t{ 0 } : (std::uint64_t{ 1 } << pegs) - 1));
+    constraints.clear();
+    blacks.clear();
+    std::ranges::fill(slots, 0);
+    position = 0;
+}
+
+void PermutationEngine::add_constraint(const Code& guess, std::uint8_t black) {
+    constraints.emplace_back(Code(guess.begin(), guess.begin() + pegs), black);
+
+    // Without any black peg, no color of the guess can be at its position
+    if (black == 0) {
+        for (size_t i = 0; i < pegs; ++i) {
+            const auto it = std::ranges::lower_bound(known_colors, guess[i]);
+            if (it != known_colors.end() && *it == guess[i]) {
+                feasible_positions[it - known_colors.begin()] &= ~(std::uint64_t{ 1 } << i);
+            }
+        }
+    }
+
+    // Black pegs of the prefix already placed
+    blacks.resize(blacks.size() + pegs + 1, 0);
+    std::uint8_t* constraint_black = constraint_blacks(constraints.size() - 1);
+    for (size_t i = 0; i < position; ++i) {
+        constraint_black[i + 1] = constraint_black[i] + (known_colors[slots[i]] == guess[i]);
+    }
+}
+
+std::optional<SearchState> PermutationEngine::next(Code& code, SearchBudget& budget) {
+    while (true) {
+        const size_t slot = slots[position];
+        if (slot >= known_colors.size()) {
+            if (position == 0u) {
+                return std::nullopt;
+            }
+
+            // Polled when backtracking only, as the solvers do
+            if (budget.is_expired()) {
+                return SearchState::interrupted;
+            }
+
+            ++remaining[slots[--position]];
+        }
+        else if (place(slot)) {
+            code[position] = known_colors[slot];
+
+            if (position == last_position) {
+                ++slots[position];
+                return SearchState::found;
+            }
+
+            --remaining[slot];
+            slots[++position] = 0;
+            continue;
+        }
+
+        ++slots[position];
+    }
+}
+
+void PermutationEngine::write_frontier(Code& code) const {
+    for (size_t i = 0; i < position; ++i) {
+        code[i] = known_colors[slots[i]];
+    }
+    auto it = code.begin() + position;
+    for (size_t slot = 0; slot < known_colors.size(); ++slot) {
+        it = std::fill_n(it, remaining[slot], known_colors[slot]);
+    }
+}
+
+void PermutationEngine::save(std::ostream& stream) const {
+    write_value<std::uint8_t>(stream, pegs);
+    write_vector(stream, known_colors);
+    write_vector(stream, remaining);
+    write_vector(stream, feasible_positions);
+    write_value<std::uint32_t>(stream, static_cast<std::uint32_t>(constraints.size()));
+    for (const auto& [guess, black] : constraints) {
+        stream.write(reinterpret_cast<const char*>(guess.data()), pegs);
+        write_value<std::uint8_t>(stream, black);
+    }
+    write_vector(stream, blacks);
+    write_vector(stream, slots);
+    write_value<std::uint32_t>(stream, static_cast<std::uint32_t>(position));
+}
+
+void PermutationEngine::load(std::istream& stream, std::uint8_t colors) {
+    const auto saved_pegs = read_value<std::uint8_t>(stream);
+    if (!stream) {
+        throw std::runtime_error("Truncated permutation engine state");
+    }
+    if (saved_pegs != pegs) {
+        throw std::runtime_error("Permutation engine saved for another number of pegs");
+    }
+
+    // Read into another engine, this one is left as it was if the state is rejected
+    PermutationEngine loaded(pegs);
+    loaded.known_colors = read_vector<Color>(stream, pegs);
+    loaded.remaining = read_vector<std::uint8_t>(stream, pegs);
+    loaded.feasible_positions = read_vector<std::uint64_t>(stream, pegs);
+    const auto nb_constraints = read_value<std::uint32_t>(stream);
+    if (!stream || nb_constraints > max_nb_constraints) {
+        throw std::runtime_error("Truncated or corrupted permutation engine state");
+    }
+    loaded.constraints.resize(nb_constraints);
+    for (auto& [guess, black] : loaded.constraints) {
+        guess.resize(pegs);
+        stream.read(reinterpret_cast<char*>(guess.data()), pegs);
+        black = read_value<std::uint8_t>(stream);
+    }
+    loaded.blacks = read_vector<std::uint8_t>(stream, nb_constraints * (pegs + 1u));
+    loaded.slots = read_vector<std::uint8_t>(stream, pegs);
+    loaded.position = read_value<std::uint32_t>(stream);
+
+    if (!stream || loaded.slots.size() != pegs || loaded.position >= pegs || loaded.remaining.size() != loaded.known_colors.size()
+        || loaded.feasible_positions.size() != loaded.known_colors.size() || loaded.blacks.size() != loaded.constraints.size() * (pegs + 1)) {
+        throw std::runtime_error("Truncated or corrupted permutation engine state");
+    }
+
+    // The enumeration indexes the known colors with the slots and writes them into codes of the board
+    const auto& known_colors = loaded.known_colors;
+    const bool valid_colors = std::ranges::all_of(known_colors, [&](Color color) { return color < colors; })
+        && std::ranges::adjacent_find(known_colors, std::greater_equal<>{}) == known_colors.end();
+    const bool valid_slots = std::ranges::all_of(loaded.slots, [&](std::uint8_t slot) { return slot <= known_colors.size(); })
+        && std::ranges::all_of(loaded.slots | std::views::take(loaded.position), [&](std::uint8_t slot) { return slot < known_colors.size(); });
+    const bool valid_constraints = std::ranges::all_of(loaded.constraints, [&](const Constraint& constraint) {
+        return constraint.black <= pegs && std::ranges::all_of(constraint.guess, [&](Color color) { return color < colors; });
+        });
+    // The colors left fill the pegs after the position, an engine never reset has none
+    const bool valid_counts = std::ranges::all_of(loaded.remaining, [&](std::uint8_t count) { return count <= pegs; })
+        && std::ranges::all_of(loaded.blacks, [&](std::uint8_t black) { return black <= pegs; })
+        && (known_colors.empty() || std::accumulate(loaded.remaining.begin(), loaded.remaining.end(), size_t{ 0 }) + loaded.position == pegs);
+    if (!valid_colors || !valid_slots || !valid_constraints || !valid_counts) {
+        throw std::runtime_error("Corrupted permutation engine state");
+    }
+
+    swap(loaded);
+}
+
+void PermutationEngine::swap(PermutationEngine& other) noexcept {
+    known_colors.swap(other.known_colors);
+    remaining.swap(other.remaining);
+    feasible_positions.swap(other.feasible_positions);
+    constraints.swap(other.constraints);
+    blacks.swap(other.blacks);
+    slots.swap(other.slots);
+    std::swap(position, other.position);
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <optional>
+#include <ostream>
+#include <vector>
+
+#include "Code.h"
+#include "SearchBudget.h"
+
+
+// PermutationEngine: once every color of the secret is known, enumerates in lexicographic order
+// the arrangements of that multiset of colors giving the right number of black pegs to every
+// constraint. The white pegs are the same for every arrangement so they are never computed.
+class PermutationEngine {
+    struct Constraint {
+        Code guess;
+        std::uint8_t black;
+    };
+
+    const std::uint8_t pegs;
+    const size_t last_position;
+    std::vector<Color> known_colors;
+    std::vector<std::uint8_t> remaining;
+    std::vector<std::uint64_t> feasible_positions;
+    std::vector<Constraint> constraints;
+    std::vector<std::uint8_t> blacks;
+    std::vector<std::uint8_t> slots;
+    size_t position;
+
+public:
+    // The feasible positions of a color are the bits of a std::uint64_t
+    static constexpr std::uint8_t max_pegs = 64;
+
+    // Throws std::invalid_argument for more than max_pegs pegs
+    PermutationEngine(std::uint8_t pegs);
+
+    // Restarts the enumeration over the colors of the code
+    void reset(const Code& code);
+
+    void add_constraint(const Code& guess, std::uint8_t black);
+
+    // Writes the next consistent arrangement in code, returns nullopt once they are exhausted
+    std::optional<SearchState> next(Code& code, SearchBudget& budget);
+
+    // Writes the pegs placed so far followed by the colors left in increasing order, an arrangement
+    // of the known colors to guess with when the enumeration was interrupted
+    void write_frontier(Code& code) const;
+
+    // Enumeration state, the enumeration goes on exactly where it stopped once loaded.
+    // Throws std::runtime_error if the state is truncated, corrupted or for another number of pegs.
+    void save(std::ostream& stream) const;
+    void load(std::istream& stream, std::uint8_t colors);
+
+    // Exchanges the states of two engines for the same number of pegs
+    void swap(PermutationEngine& other) noexcept;
+
+private:
+    inline std::uint8_t* constraint_blacks(size_t constraint) { return &blacks[constraint * (pegs + 1)]; }
+
+    inline bool place(size_t slot) {
+        const Color color = known_colors[slot];
+        if (remaining[slot] == 0 || !(feasible_positions[slot] & (std::uint64_t{ 1 } << position))) {
+            return false;
+        }
+
+        const size_t left = last_position - position;
+        for (size_t i = 0; i < constraints.size(); ++i) {
+            std::uint8_t* black = constraint_blacks(i);
+            const std::uint8_t b = black[position] + (constraints[i].guess[position] == color);
+            if (b > constraints[i].black || b + left < constraints[i].black) {
+                return false;
+            }
+            black[position + 1] = b;
+        }
+        return true;
+    }
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <span>
+#include <sstream>
+#include <vector>
+
+#include "Code.h"
+#include "GameTrace.h"
+
+
+struct ReplayStatistics {
+    std::chrono::nanoseconds min;
+    std::chrono::nanoseconds median;
+    Code guess;
+    bool matches_trace;     // The guess is the one recorded, always true past the last move
+    bool rescanned;         // No checkpoint was recorded, the search started over from the first code
+};
+
+// Times the search for the next guess at the state reached after the first nb_moves moves of the game.
+// The solver is restored at that state for every iteration so that only the search itself is timed.
+// It resumes from the checkpoint recorded after the last move, as the game did; a trace without
+// checkpoints only gives the time of a search rescanning from the first code.
+template <class Solver>
+ReplayStatistics benchmark_state(const GameTrace& game_trace, size_t nb_moves, unsigned int nb_iterations)
+{
+    const auto& moves = game_trace.get_moves();
+    const std::span<const GameTrace::Move> history(moves.data(), nb_moves);
+    const std::uint8_t pegs = game_trace.get_pegs();
+
+    std::vector<std::chrono::nanoseconds> times;
+    times.reserve(nb_iterations);
+    const bool rescanned = nb_moves > 0 && moves[nb_moves - 1].checkpoint.empty();
+    Code guess;
+    for (unsigned int i = 0; i < nb_iterations; ++i) {
+        Solver solver(pegs, game_trace.get_colors(), rescanned ? history : std::span<const GameTrace::Move>{});
+        if (nb_moves > 0 && !rescanned) {
+            std::istringstream checkpoint(moves[nb_moves - 1].checkpoint, std::ios::binary);
+            solver.load(checkpoint);
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        const auto& [next_guess, next_guess_frequency_map] = solver.next_guess();
+        const auto end = std::chrono::steady_clock::now();
+
+        times.emplace_back(end - start);
+        guess.assign(next_guess.begin(), next_guess.begin() + pegs);
+    }
+
+    std::ranges::sort(times);
+    const bool matches_trace = nb_moves >= moves.size() || guess == moves[nb_moves].guess;
+    return { times.front(), times[times.size() / 2], guess, matches_trace, rescanned };
+}
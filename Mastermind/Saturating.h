@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+
+
+// Counts of codes stop at the largest value instead of wrapping around, 16 pegs of 16 colors already make 2^64 codes
+inline std::uint64_t saturating_add(std::uint64_t lhs, std::uint64_t rhs) {
+    constexpr std::uint64_t max = std::numeric_limits<std::uint64_t>::max();
+    return lhs > max - rhs ? max : lhs + rhs;
+}
+
+inline std::uint64_t saturating_multiply(std::uint64_t lhs, std::uint64_t rhs) {
+    constexpr std::uint64_t max = std::numeric_limits<std::uint64_t>::max();
+    return rhs != 0 && lhs > max / rhs ? max : lhs * rhs;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <stop_token>
+
+
+enum class SearchState {
+    found,          // The code is consistent with the whole history
+    interrupted,    // The budget ran out, the search resumes from where it stopped
+};
+
+// Outcome of a bounded guess
+enum class GuessQuality {
+    consistent,     // The guess is consistent with the whole history
+    partial,        // The budget ran out, the guess is a best effort built from the search frontier
+    no_candidate,   // No code is consistent with the history, the feedbacks contradict each other
+};
+
+// SearchBudget: deadline and cancellation bounding a search. The searches poll it when they backtrack,
+// the clock and the stop token are only looked at every few thousand polls.
+class SearchBudget {
+    static constexpr std::uint32_t check_period = 4096;
+
+    std::chrono::steady_clock::time_point deadline;
+    std::stop_token stop_token;
+    bool bounded;
+    std::uint32_t nb_polls_until_check;
+
+public:
+    // Unbounded
+    SearchBudget()
+        : deadline(std::chrono::steady_clock::time_point::max())
+        , bounded(false)
+        , nb_polls_until_check(check_period)
+    {}
+
+    // The first poll looks at the clock, a budget spent before the search stops it at once
+    SearchBudget(std::chrono::steady_clock::duration budget, std::stop_token stop_token = {})
+        : deadline(std::chrono::steady_clock::now() + budget)
+        , stop_token(std::move(stop_token))
+        , bounded(true)
+        , nb_polls_until_check(1)
+    {}
+
+    inline bool is_expired() {
+        if (!bounded || --nb_polls_until_check != 0) {
+            return false;
+        }
+
+        nb_polls_until_check = check_period;
+        return stop_token.stop_requested() || std::chrono::steady_clock::now() >= deadline;
+    }
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <type_traits>
+#include <vector>
+
+
+// Fixed width values in the byte order of the machine, the files are written and read back on x86 only
+template <typename T>
+    requires std::is_trivially_copyable_v<T>
+inline void write_value(std::ostream& stream, T value) {
+    stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+    requires std::is_trivially_copyable_v<T>
+inline T read_value(std::istream& stream) {
+    // A byte other than 0 or 1 is no bool, it fails the stream
+    if constexpr (std::is_same_v<T, bool>) {
+        const auto byte = read_value<std::uint8_t>(stream);
+        if (byte > 1) {
+            stream.setstate(std::ios::failbit);
+        }
+        return byte == 1;
+    }
+    else {
+        T value{};
+        stream.read(reinterpret_cast<char*>(&value), sizeof(T));
+        return value;
+    }
+}
+
+// Size then elements
+template <typename T>
+    requires std::is_trivially_copyable_v<T>
+inline void write_vector(std::ostream& stream, const std::vector<T>& values) {
+    write_value<std::uint32_t>(stream, static_cast<std::uint32_t>(values.size()));
+    stream.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+}
+
+// The size comes from the file, above max_size the stream fails rather than allocating it
+template <typename T>
+    requires std::is_trivially_copyable_v<T>
+inline std::vector<T> read_vector(std::istream& stream, std::uint32_t max_size) {
+    const auto size = read_value<std::uint32_t>(stream);
+    if (!stream || size > max_size) {
+        stream.setstate(std::ios::failbit);
+        return {};
+    }
+
+    std::vector<T> values(size);
+    stream.read(reinterpret_cast<char*>(values.data()), values.size() * sizeof(T));
+    return values;
+}
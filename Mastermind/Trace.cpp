@@ -0,0 +1,70 @@
+#include "Trace.h"
+
+#ifdef MASTERMIND_TRACING
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+namespace trace {
+
+namespace {
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Buffer>> buffers;
+    const std::uint64_t origin_ticks = now();
+    const std::chrono::steady_clock::time_point origin_time = std::chrono::steady_clock::now();
+};
+
+Registry& registry() {
+    static Registry registry;
+    return registry;
+}
+
+}
+
+Buffer& local_buffer() {
+    thread_local Buffer& buffer = [] () -> Buffer& {
+        Registry& r = registry();
+        std::scoped_lock lock(r.mutex);
+        return *r.buffers.emplace_back(std::make_unique<Buffer>(static_cast<std::uint32_t>(r.buffers.size())));
+    }();
+    return buffer;
+}
+
+void write_chrome_trace(std::ostream& stream) {
+    Registry& r = registry();
+    std::scoped_lock lock(r.mutex);
+
+    // Calibrate the time stamp counter against the steady clock over the whole run
+    const double elapsed_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - r.origin_time).count();
+    const double ticks_per_us = elapsed_us > 0.0 ? static_cast<double>(now() - r.origin_ticks) / elapsed_us : 1.0;
+    const auto to_us = [&](std::int64_t ticks) { return static_cast<double>(ticks) / ticks_per_us; };
+
+    stream << std::fixed << "{\"traceEvents\":[";
+    const char* separator = "\n";
+    for (const auto& buffer : r.buffers) {
+        const std::uint32_t pid = buffer->get_thread_index();
+        stream << separator << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"args\":{\"name\":\"Thread " << pid << "\"}}";
+        separator = ",\n";
+
+        buffer->for_each([&](const Event& event) {
+            stream << separator << "{\"name\":\"" << event.name << "\",\"pid\":" << pid << ",\"tid\":" << event.game
+                << ",\"ts\":" << to_us(static_cast<std::int64_t>(event.start - r.origin_ticks));
+            if (event.duration == 0) {
+                stream << ",\"ph\":\"i\",\"s\":\"t\"}";
+            }
+            else {
+                stream << ",\"ph\":\"X\",\"dur\":" << to_us(static_cast<std::int64_t>(event.duration)) << '}';
+            }
+        });
+    }
+    stream << "\n]}\n";
+}
+
+}
+
+#endif
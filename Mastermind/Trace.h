@@ -0,0 +1,92 @@
+#pragma once
+
+// Low overhead per move tracing, exported in the Chrome trace event format (chrome://tracing, ui.perfetto.dev).
+// Compiled out entirely unless MASTERMIND_TRACING is defined.
+
+#ifdef MASTERMIND_TRACING
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+
+
+namespace trace {
+
+struct Event {
+    const char* name;
+    std::uint64_t start;
+    std::uint64_t duration;    // 0 for an instant event
+    std::uint32_t game;
+};
+
+// Buffer: ring of the most recent events of one thread
+class Buffer {
+    static constexpr size_t capacity = 1 << 16;
+
+    std::array<Event, capacity> events;
+    size_t nb_events = 0;
+    std::uint32_t thread_index;
+    std::uint32_t game = 0;
+
+public:
+    Buffer(std::uint32_t thread_index) : thread_index(thread_index) {}
+
+    inline void push(const char* name, std::uint64_t start, std::uint64_t duration) {
+        events[nb_events++ % capacity] = { name, start, duration, game };
+    }
+
+    inline void set_game(std::uint32_t game) { this->game = game; }
+
+    std::uint32_t get_thread_index() const { return thread_index; }
+
+    template <typename Func>
+    void for_each(Func func) const {
+        const size_t first = nb_events > capacity ? nb_events - capacity : 0;
+        for (size_t i = first; i < nb_events; ++i) {
+            func(events[i % capacity]);
+        }
+    }
+};
+
+Buffer& local_buffer();
+
+inline std::uint64_t now() { return __rdtsc(); }
+
+// Scope: records the duration of the enclosing scope
+class Scope {
+    const char* name;
+    std::uint64_t start;
+public:
+    Scope(const char* name) : name(name), start(now()) {}
+    ~Scope() { local_buffer().push(name, start, now() - start); }
+};
+
+inline void instant(const char* name) { local_buffer().push(name, now(), 0); }
+
+// Events recorded next on this thread belong to the game, each game getting its own track
+inline void begin_game(std::uint32_t game) { local_buffer().set_game(game); }
+
+// Writes the events of every thread as a Chrome trace, one process per thread and one track per game
+void write_chrome_trace(std::ostream& stream);
+
+}
+
+#define TRACE_CONCATENATE_IMPL(a, b) a##b
+#define TRACE_CONCATENATE(a, b) TRACE_CONCATENATE_IMPL(a, b)
+#define TRACE_SCOPE(name) const trace::Scope TRACE_CONCATENATE(trace_scope_, __LINE__)(name)
+#define TRACE_INSTANT(name) trace::instant(name)
+#define TRACE_GAME(game) trace::begin_game(game)
+
+#else
+
+#define TRACE_SCOPE(name)
+#define TRACE_INSTANT(name)
+#define TRACE_GAME(game)
+
+#endif
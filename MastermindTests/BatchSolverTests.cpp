@@ -0,0 +1,45 @@
+#include <algorithm>
+#include <cstdint>
+#include <ranges>
+#include <vector>
+
+#include "BatchSolver.h"
+#include "DuplicateSolver.h"
+#include "Games.h"
+#include "NoDuplicateSolver.h"
+#include "Test.h"
+
+
+namespace {
+
+// Sharing the searches of the games changes nothing to them, every secret of the board takes as many guesses
+// as in a game of its own and ends on the secret
+template<class Solver> void check_batch_matches_games(unsigned int& nb_failures, std::uint8_t pegs, std::uint8_t colors, bool distinct_colors) {
+    const std::vector<Code> secrets = all_codes(pegs, colors, distinct_colors);
+    const auto results = BatchSolver<Solver>(pegs, colors).solve(secrets);
+    CHECK(results.size() == secrets.size());
+    if (results.size() != secrets.size()) {
+        return;
+    }
+
+    unsigned int nb_different = 0;
+    for (size_t i = 0; i < secrets.size(); ++i) {
+        Solver solver(pegs, colors);
+        const auto guesses = play(solver, secrets[i]);
+        const auto& [final_guess, nb_guesses] = results[i];
+        nb_different += nb_guesses != guesses.size()
+            || final_guess.size() < pegs
+            || !std::ranges::equal(final_guess | std::views::take(pegs), secrets[i]);
+    }
+    CHECK(nb_different == 0);
+}
+
+}
+
+TEST(duplicate_batch_matches_games) {
+    check_batch_matches_games<duplicate::Solver>(nb_failures, 4, 6, false);
+}
+
+TEST(no_duplicate_batch_matches_games) {
+    check_batch_matches_games<no_duplicate::Solver>(nb_failures, 5, 7, true);
+}
@@ -0,0 +1,36 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <random>
+
+#include "CheckOrder.h"
+#include "Test.h"
+
+
+// Entries rejecting a node with very different rates get reordered, every node must still be accepted exactly when
+// checking the entries in the order they were added, without any reordering, accepts it
+TEST(check_order_reordering_keeps_results) {
+    const std::array<unsigned int, 6> rejection_percents{ 90, 60, 30, 10, 5, 1 };
+    CheckOrder<unsigned int> check_order;
+    for (const unsigned int& rejection_percent : rejection_percents) {
+        check_order.add(rejection_percent);
+    }
+    const auto added_order = check_order.get_checks();
+
+    std::mt19937 random(2024);
+    std::uniform_int_distribution<unsigned int> draw(0, 99);
+    unsigned int nb_different = 0;
+    for (unsigned int i = 0; i < 10000; ++i) {
+        std::array<unsigned int, rejection_percents.size()> node{};
+        std::ranges::generate(node, [&] { return draw(random); });
+        const auto accepts = [&](const unsigned int& rejection_percent) {
+            return node[&rejection_percent - rejection_percents.data()] >= rejection_percent;
+        };
+        nb_different += check_order.all_of(accepts) != std::ranges::all_of(rejection_percents, accepts);
+    }
+    CHECK(nb_different == 0);
+
+    // Added entries are checked first, so the least rejecting one came first until the reordering
+    CHECK(added_order.front().entry == &rejection_percents.back());
+    CHECK(check_order.get_checks().front().entry == &rejection_percents.front());
+}
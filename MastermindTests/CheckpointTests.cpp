@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <chrono>
+#include <ranges>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "DuplicateSolver.h"
+#include "NoDuplicateSolver.h"
+#include "SearchBudget.h"
+#include "Test.h"
+
+
+namespace {
+
+template<class Solver> bool load_throws(Solver& solver, const std::string& checkpoint) {
+    std::istringstream stream(checkpoint, std::ios::binary);
+    try {
+        solver.load(stream);
+    }
+    catch (const std::runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+// Checkpoints after every move of a game, with the search interrupted once, from the first peg placed to the permutations
+template<class Solver, class... Args> std::vector<std::string> save_game(Args... args) {
+    Solver solver(5, 8, args...);
+    auto feedback_calculator = solver.get_feedback_calculator();
+    feedback_calculator.set_secret(Code{ 7, 6, 5, 4, 3 });
+    std::vector<std::string> checkpoints;
+    while (solver.can_continue()) {
+        solver.next_guess(SearchBudget(std::chrono::nanoseconds(0)));
+        std::ostringstream stream(std::ios::binary);
+        solver.save(stream);
+        checkpoints.push_back(std::move(stream).str());
+
+        const auto& [guess, guess_frequency_map] = solver.next_guess();
+        const Feedback feedback = feedback_calculator.get_feedback(guess, guess_frequency_map);
+        if (feedback.black() == 5) {
+            break;
+        }
+        solver.apply_feedback(feedback);
+    }
+    return checkpoints;
+}
+
+// Every corrupted byte either loads into a solver that plays on or is rejected, never anything else
+template<class Solver, class... Args> void check_corrupted_bytes(unsigned int& nb_failures, const std::vector<std::string>& checkpoints, Args... args) {
+    for (const auto& checkpoint : checkpoints) {
+        for (size_t i = 0; i < checkpoint.size(); ++i) {
+            for (const char corruption : { '\x01', '\x80', '\xFF' }) {
+                std::string corrupted = checkpoint;
+                corrupted[i] ^= corruption;
+
+                Solver solver(5, 8, args...);
+                if (!load_throws(solver, corrupted)) {
+                    for (unsigned int j = 0; j < 3 && solver.can_continue(); ++j) {
+                        solver.next_guess();
+                        solver.apply_feedback(Feedback(0, 0));
+                    }
+                }
+            }
+        }
+
+        Solver solver(5, 8, args...);
+        CHECK(load_throws(solver, checkpoint.substr(0, checkpoint.size() / 2)));
+    }
+}
+
+
+// A check order checking an entry twice is rejected, and the rejected checkpoint leaves the solver as it was
+template<class Solver, class... Args> void check_repeated_check(unsigned int& nb_failures, size_t header_size, Args... args) {
+    const auto checkpoints = save_game<Solver>(args...);
+    CHECK(checkpoints.size() > 2);
+    if (checkpoints.size() <= 2) {
+        return;
+    }
+
+    // Two history entries of five pegs and two feedback bytes, then the counter of the first check order
+    // and its checks of an index and two counters
+    const size_t first_index = header_size + 4 + 2 * 7 + 8;
+    std::string repeated_check = checkpoints[2];
+    repeated_check.replace(first_index + 20, 4, repeated_check, first_index, 4);
+
+    Solver solver(5, 8, args...);
+    Solver reference(5, 8, args...);
+    CHECK(!load_throws(solver, checkpoints[1]));
+    CHECK(!load_throws(reference, checkpoints[1]));
+    CHECK(load_throws(solver, repeated_check));
+
+    const auto& [guess, guess_frequency_map] = solver.next_guess();
+    const auto& [reference_guess, reference_guess_frequency_map] = reference.next_guess();
+    CHECK(std::ranges::equal(guess | std::views::take(5), reference_guess | std::views::take(5)));
+}
+
+}
+
+TEST(duplicate_checkpoint_rejects_corruption) {
+    duplicate::Solver solver(5, 8);
+    std::ostringstream stream(std::ios::binary);
+    solver.save(stream);
+    const std::string checkpoint = std::move(stream).str();
+    CHECK(!load_throws(solver, checkpoint));
+
+    // Magic and version, pegs, colors and search engine, then the number of history entries
+    std::string huge_history = checkpoint;
+    huge_history.replace(8, 4, "\xFF\xFF\xFF\xFF");
+    CHECK(load_throws(solver, huge_history));
+
+    // Without history the check orders only hold their counters, the code comes right after them
+    std::string out_of_range_color = checkpoint;
+    out_of_range_color[8 + 4 + 8 * 5] = 200;
+    CHECK(load_throws(solver, out_of_range_color));
+
+    check_corrupted_bytes<duplicate::Solver>(nb_failures, save_game<duplicate::Solver>(duplicate::SearchEngine::backtrack), duplicate::SearchEngine::backtrack);
+    check_corrupted_bytes<duplicate::Solver>(nb_failures, save_game<duplicate::Solver>(duplicate::SearchEngine::two_level), duplicate::SearchEngine::two_level);
+    check_repeated_check<duplicate::Solver>(nb_failures, 8, duplicate::SearchEngine::backtrack);
+}
+
+TEST(no_duplicate_checkpoint_rejects_corruption) {
+    no_duplicate::Solver solver(5, 8);
+    std::ostringstream stream(std::ios::binary);
+    solver.save(stream);
+    const std::string checkpoint = std::move(stream).str();
+    CHECK(!load_throws(solver, checkpoint));
+
+    // Magic and version, pegs and colors, then the number of history entries
+    std::string huge_history = checkpoint;
+    huge_history.replace(7, 4, "\xFF\xFF\xFF\xFF");
+    CHECK(load_throws(solver, huge_history));
+
+    std::string out_of_range_color = checkpoint;
+    out_of_range_color[7 + 4 + 8 * 5] = 200;
+    CHECK(load_throws(solver, out_of_range_color));
+
+    check_corrupted_bytes<no_duplicate::Solver>(nb_failures, save_game<no_duplicate::Solver>());
+    check_repeated_check<no_duplicate::Solver>(nb_failures, 7);
+}
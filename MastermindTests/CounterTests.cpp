@@ -0,0 +1,78 @@
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "DuplicateCounter.h"
+#include "DuplicateSolver.h"
+#include "Games.h"
+#include "NoDuplicateCounter.h"
+#include "NoDuplicateSolver.h"
+#include "Test.h"
+
+
+namespace {
+
+// Random boards and constraints, mostly the feedbacks of a random secret and sometimes any feedback at all, the count
+// and the partition of a random guess must match the enumeration of every code of the board
+template<class Solver, class Counter, class FrequencyMap>
+void check_counter_against_enumeration(unsigned int& nb_failures, bool distinct_colors, unsigned int nb_trials) {
+    std::mt19937 random(2024);
+    const auto draw = [&random](unsigned int low, unsigned int high) {
+        return std::uniform_int_distribution<unsigned int>(low, high)(random);
+    };
+
+    for (unsigned int trial = 0; trial < nb_trials; ++trial) {
+        const auto pegs = static_cast<std::uint8_t>(draw(3, 5));
+        const auto colors = static_cast<std::uint8_t>(draw(distinct_colors ? pegs : 2, 6));
+        const std::vector<Code> codes = all_codes(pegs, colors, distinct_colors);
+        auto feedback_calculator = Solver(pegs, colors).get_feedback_calculator();
+        const auto get_feedback = [&](const Code& secret, const Code& guess) {
+            feedback_calculator.set_secret(secret);
+            return feedback_calculator.get_feedback(guess, make_frequency_map<FrequencyMap>(guess, pegs, colors));
+        };
+
+        Counter counter(pegs, colors);
+        std::vector<std::pair<Code, Feedback>> constraints;
+        const Code secret = pad(codes[draw(0, codes.size() - 1)]);
+        for (unsigned int i = draw(1, 3); i > 0; --i) {
+            const Code guess = pad(codes[draw(0, codes.size() - 1)]);
+            Feedback feedback = get_feedback(secret, guess);
+            if (draw(0, 3) == 0) {
+                const unsigned int black = draw(0, pegs);
+                feedback = Feedback(black, draw(0, pegs - black));
+            }
+            counter.add_constraint(guess, make_frequency_map<FrequencyMap>(guess, pegs, colors), feedback);
+            constraints.emplace_back(guess, feedback);
+        }
+
+        const Code probe = pad(codes[draw(0, codes.size() - 1)]);
+        std::uint64_t expected_count = 0;
+        std::vector<std::uint64_t> expected_partition((pegs + 1) * (pegs + 1), 0);
+        for (const Code& code : codes) {
+            const Code candidate = pad(code);
+            const bool consistent = std::ranges::all_of(constraints, [&](const auto& constraint) {
+                return get_feedback(candidate, constraint.first) == constraint.second;
+            });
+            if (consistent) {
+                ++expected_count;
+                const Feedback feedback = get_feedback(candidate, probe);
+                ++expected_partition[feedback.black() * (pegs + 1) + feedback.white()];
+            }
+        }
+
+        CHECK(counter.count() == expected_count);
+        CHECK(counter.partition(probe, make_frequency_map<FrequencyMap>(probe, pegs, colors)) == expected_partition);
+    }
+}
+
+}
+
+TEST(duplicate_counter_matches_enumeration) {
+    check_counter_against_enumeration<duplicate::Solver, duplicate::Counter, duplicate::FrequencyMap>(nb_failures, false, 180);
+}
+
+TEST(no_duplicate_counter_matches_enumeration) {
+    check_counter_against_enumeration<no_duplicate::Solver, no_duplicate::Counter, no_duplicate::FrequencyMap>(nb_failures, true, 180);
+}
@@ -0,0 +1,74 @@
+#include <algorithm>
+#include <sstream>
+
+#include "Evaluation.h"
+#include "Test.h"
+
+
+namespace {
+
+EvaluationResult make_shard_result(std::uint32_t shard, std::uint32_t nb_shards) {
+    EvaluationResult result(4, 6, 1, shard, nb_shards);
+    result.add_game(0, Code{ 0, 1, 2, 3 }, 4 + shard, std::chrono::microseconds(10));
+    return result;
+}
+
+std::optional<EvaluationResult> write_and_read(const EvaluationResult& result) {
+    std::stringstream stream;
+    result.write(stream);
+    return EvaluationResult::read(stream);
+}
+
+}
+
+TEST(evaluation_round_trip) {
+    const auto result = write_and_read(make_shard_result(1, 2));
+    CHECK(result);
+    CHECK(result && result->get_nb_guesses_histogram().size() == 6 && result->get_nb_guesses_histogram()[5] == 1);
+}
+
+TEST(evaluation_merge_needs_every_shard_once) {
+    auto result = make_shard_result(0, 3);
+    CHECK(!result.is_complete());
+    CHECK(result.merge(make_shard_result(2, 3)));
+    CHECK(!result.merge(make_shard_result(2, 3)));
+    CHECK(!result.is_complete());
+    CHECK(!result.merge(make_shard_result(1, 2)));
+    CHECK(result.merge(make_shard_result(1, 3)));
+    CHECK(result.is_complete());
+}
+
+TEST(evaluation_merge_needs_same_board) {
+    auto result = make_shard_result(0, 2);
+    EvaluationResult other(5, 6, 1, 1, 2);
+    CHECK(!result.merge(other));
+}
+
+TEST(evaluation_read_rejects_oversized_lengths) {
+    std::stringstream stream;
+    make_shard_result(0, 1).write(stream);
+    std::string bytes = stream.str();
+
+    // Number of tries, right after the magic, the version, the board, the shards and the number of batches
+    const size_t nb_tries_offset = 4 + 1 + 2 + 4 + 4 + 4 + 8;
+    const std::uint32_t nb_tries = 0xFFFFFFFF;
+    bytes.replace(nb_tries_offset, sizeof(nb_tries), reinterpret_cast<const char*>(&nb_tries), sizeof(nb_tries));
+
+    std::stringstream corrupted(bytes);
+    CHECK(!EvaluationResult::read(corrupted));
+}
+
+TEST(evaluation_batches_keep_no_latency) {
+    EvaluationResult result(4, 6, 1, 0, 2);
+    result.add_batch_game(0, Code{ 0, 1, 2, 3 }, 4);
+    result.add_batch_game(0, Code{ 3, 2, 1, 0 }, 5);
+    result.add_batch(0, std::chrono::microseconds(100));
+
+    const auto read_result = write_and_read(result);
+    CHECK(read_result && read_result->get_nb_batches() == 1);
+    CHECK(read_result && read_result->get_try_times()[0] == std::chrono::microseconds(100));
+    CHECK(read_result && std::ranges::all_of(read_result->get_latency_histogram(), [](std::uint64_t nb_games) { return nb_games == 0; }));
+
+    // Batch times and game times do not add up
+    CHECK(!result.merge(make_shard_result(1, 2)));
+}
@@ -0,0 +1,75 @@
+#include <sstream>
+
+#include "DuplicateSolver.h"
+#include "GameTrace.h"
+#include "NoDuplicateSolver.h"
+#include "Replay.h"
+#include "Test.h"
+
+
+TEST(game_trace_round_trip_past_255_moves) {
+    GameTrace game_trace(4, 6);
+    for (unsigned int i = 0; i < 300; ++i) {
+        game_trace.add_move(Code{ 0, 1, 2, 3 }, Feedback(i % 5, 0));
+    }
+    game_trace.set_checkpoint("checkpoint");
+
+    std::stringstream stream;
+    game_trace.write(stream);
+    const auto read_game_trace = GameTrace::read(stream);
+    CHECK(read_game_trace);
+    CHECK(read_game_trace && read_game_trace->get_moves().size() == 300);
+    CHECK(read_game_trace && read_game_trace->get_moves().back().feedback == Feedback(299 % 5, 0));
+    CHECK(read_game_trace && read_game_trace->get_moves().back().checkpoint == "checkpoint");
+}
+
+TEST(game_trace_rejects_invalid_boards_and_moves) {
+    const auto read_back = [](const GameTrace& game_trace) {
+        std::stringstream stream;
+        game_trace.write(stream);
+        return GameTrace::read(stream).has_value();
+    };
+
+    CHECK(read_back(GameTrace(4, 6)));
+    CHECK(!read_back(GameTrace(0, 6)));
+    CHECK(!read_back(GameTrace(4, 0)));
+
+    GameTrace color_out_of_board(4, 6);
+    color_out_of_board.add_move(Code{ 0, 1, 2, 6 }, Feedback(0, 0));
+    CHECK(!read_back(color_out_of_board));
+
+    GameTrace too_many_pegs(4, 6);
+    too_many_pegs.add_move(Code{ 0, 1, 2, 3 }, Feedback(3, 2));
+    CHECK(!read_back(too_many_pegs));
+
+    // A trace can still hold a board beyond the limits of a solver, the replay checks them
+    CHECK(duplicate::Solver::supports(64, 240));
+    CHECK(!duplicate::Solver::supports(65, 6));
+    CHECK(!duplicate::Solver::supports(4, 241));
+    CHECK(no_duplicate::Solver::supports(6, 6));
+    CHECK(!no_duplicate::Solver::supports(7, 6));
+    CHECK(!no_duplicate::Solver::supports(4, 33));
+}
+
+TEST(game_trace_replay_resumes_from_checkpoints) {
+    duplicate::Solver solver(4, 6);
+    GameTrace game_trace(4, 6);
+    solver.set_game_trace(&game_trace);
+    auto feedback_calculator = solver.get_feedback_calculator();
+    feedback_calculator.set_secret(Code{ 5, 4, 3, 2 });
+    while (solver.can_continue()) {
+        const auto& [guess, guess_frequency_map] = solver.next_guess();
+        const Feedback feedback = feedback_calculator.get_feedback(guess, guess_frequency_map);
+        if (feedback.black() == 4) {
+            break;
+        }
+        solver.apply_feedback(feedback);
+    }
+
+    CHECK(game_trace.get_moves().size() > 1);
+    for (size_t nb_moves = 0; nb_moves < game_trace.get_moves().size(); ++nb_moves) {
+        const auto statistics = benchmark_state<duplicate::Solver>(game_trace, nb_moves, 1);
+        CHECK(statistics.matches_trace);
+        CHECK(!statistics.rescanned);
+    }
+}
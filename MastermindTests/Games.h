@@ -0,0 +1,133 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "Code.h"
+#include "DuplicateSolver.h"
+#include "Feedback.h"
+#include "NoDuplicateSolver.h"
+#include "SearchBudget.h"
+
+
+// Every code of the board in lexicographic order, only the ones without a repeated color if asked
+inline std::vector<Code> all_codes(std::uint8_t pegs, std::uint8_t colors, bool distinct_colors) {
+    std::vector<Code> codes;
+    Code code(pegs, 0);
+    while (true) {
+        std::vector<bool> used(colors, false);
+        bool distinct = true;
+        for (const Color color : code) {
+            distinct = distinct && !used[color];
+            used[color] = true;
+        }
+        if (distinct || !distinct_colors) {
+            codes.push_back(code);
+        }
+
+        size_t peg = pegs;
+        while (peg-- > 0 && ++code[peg] == colors) {
+            code[peg] = 0;
+        }
+        if (peg > pegs) {
+            return codes;
+        }
+    }
+}
+
+// Code padded as the duplicate solver plays them, its feedback calculator reads 16 pegs at a time
+inline Code pad(const Code& code) {
+    Code padded((code.size() + 15) / 16 * 16, 0);
+    std::ranges::copy(code, padded.begin());
+    return padded;
+}
+
+template<class FrequencyMap> FrequencyMap make_frequency_map(const Code& code, std::uint8_t pegs, std::uint8_t colors) {
+    if constexpr (std::is_same_v<FrequencyMap, no_duplicate::FrequencyMap>) {
+        FrequencyMap frequency_map;
+        for (size_t i = 0; i < pegs; ++i) {
+            frequency_map.set(code[i]);
+        }
+        return frequency_map;
+    }
+    else {
+        FrequencyMap frequency_map(colors);
+        for (size_t i = 0; i < pegs; ++i) {
+            ++frequency_map[code[i]];
+        }
+        return frequency_map;
+    }
+}
+
+// Guesses of the strategy of the exhaustive solvers found by enumerating the codes of the board: every guess is the
+// first code in lexicographic order consistent with all the feedbacks so far
+template<class Solver, class FrequencyMap>
+std::vector<Code> play_first_consistent(std::uint8_t pegs, std::uint8_t colors, const std::vector<Code>& codes, const Code& secret) {
+    auto feedback_calculator = Solver(pegs, colors).get_feedback_calculator();
+    feedback_calculator.set_secret(pad(secret));
+    std::vector<Code> candidates;
+    for (const Code& code : codes) {
+        candidates.push_back(pad(code));
+    }
+
+    std::vector<Code> guesses;
+    while (!candidates.empty()) {
+        const Code guess = candidates.front();
+        const FrequencyMap guess_frequency_map = make_frequency_map<FrequencyMap>(guess, pegs, colors);
+        guesses.emplace_back(guess.begin(), guess.begin() + pegs);
+        const Feedback feedback = feedback_calculator.get_feedback(guess, guess_frequency_map);
+        if (feedback.black() == pegs) {
+            break;
+        }
+
+        auto candidate_feedback_calculator = feedback_calculator;
+        std::erase_if(candidates, [&](const Code& candidate) {
+            candidate_feedback_calculator.set_secret(candidate);
+            return candidate_feedback_calculator.get_feedback(guess, guess_frequency_map) != feedback;
+        });
+    }
+    return guesses;
+}
+
+// Guesses of a game against the secret, cut to the pegs of the secret
+template<class Solver> std::vector<Code> play(Solver& solver, const Code& secret) {
+    auto feedback_calculator = solver.get_feedback_calculator();
+    feedback_calculator.set_secret(secret);
+    std::vector<Code> guesses;
+    while (solver.can_continue()) {
+        const auto& [guess, guess_frequency_map] = solver.next_guess();
+        if (!solver.can_continue()) {
+            break;
+        }
+        guesses.emplace_back(guess.begin(), guess.begin() + secret.size());
+        const Feedback feedback = feedback_calculator.get_feedback(guess, guess_frequency_map);
+        if (feedback.black() == secret.size()) {
+            break;
+        }
+        solver.apply_feedback(feedback);
+    }
+    return guesses;
+}
+
+// Same with every move searching for at most the budget, the game is given up after the number of guesses
+template<class Solver> std::vector<Code> play_capped(Solver& solver, const Code& secret, std::chrono::nanoseconds move_budget, size_t max_nb_guesses) {
+    auto feedback_calculator = solver.get_feedback_calculator();
+    feedback_calculator.set_secret(secret);
+    std::vector<Code> guesses;
+    while (guesses.size() < max_nb_guesses) {
+        const auto [guess, guess_frequency_map, guess_quality] = solver.next_guess(SearchBudget(move_budget));
+        if (guess_quality == GuessQuality::no_candidate) {
+            break;
+        }
+        guesses.emplace_back(guess.begin(), guess.begin() + secret.size());
+        const Feedback feedback = feedback_calculator.get_feedback(guess, guess_frequency_map);
+        if (feedback.black() == secret.size()) {
+            break;
+        }
+        solver.apply_feedback(feedback);
+    }
+    return guesses;
+}
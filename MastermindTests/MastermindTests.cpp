@@ -0,0 +1,19 @@
+#include <iostream>
+
+#include "Test.h"
+
+
+int main() {
+    unsigned int nb_failed_tests = 0;
+    for (const auto& [name, run] : get_test_cases()) {
+        unsigned int nb_failures = 0;
+        run(nb_failures);
+        std::cout << (nb_failures == 0 ? "[pass] " : "[FAIL] ") << name << std::endl;
+        if (nb_failures != 0) {
+            ++nb_failed_tests;
+        }
+    }
+
+    std::cout << get_test_cases().size() - nb_failed_tests << "/" << get_test_cases().size() << " tests passed" << std::endl;
+    return nb_failed_tests == 0 ? 0 : 1;
+}
@@ -0,0 +1,290 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <ranges>
+#include <stdexcept>
+
+#include "DuplicateGeneticSolver.h"
+#include "DuplicateMonteCarloSolver.h"
+#include "DuplicateSolver.h"
+#include "Games.h"
+#include "NoDuplicateSolver.h"
+#include "PermutationEngine.h"
+#include "SearchBudget.h"
+#include "Test.h"
+
+
+namespace {
+
+// Three black pegs and one white peg cannot be the feedback of any code of four pegs, so no code is left
+template<class Solver> void check_no_candidate_left(unsigned int& nb_failures) {
+    Solver solver(4, 6);
+    CHECK(solver.can_continue());
+    solver.next_guess();
+    solver.apply_feedback(Feedback(3, 1));
+    solver.next_guess();
+    CHECK(!solver.can_continue());
+
+    const auto [guess, guess_frequency_map, guess_quality] = solver.next_guess(SearchBudget(std::chrono::seconds(1)));
+    CHECK(guess_quality == GuessQuality::no_candidate);
+}
+
+template<class Solver> void check_no_candidate_left_bounded(unsigned int& nb_failures) {
+    Solver solver(4, 6);
+    const auto [first_guess, first_guess_frequency_map, first_guess_quality] = solver.next_guess(SearchBudget(std::chrono::seconds(1)));
+    CHECK(first_guess_quality == GuessQuality::consistent);
+    solver.apply_feedback(Feedback(3, 1));
+
+    const auto [guess, guess_frequency_map, guess_quality] = solver.next_guess(SearchBudget(std::chrono::seconds(1)));
+    CHECK(guess_quality == GuessQuality::no_candidate);
+    CHECK(!solver.can_continue());
+}
+
+// A budget spent before the search interrupts it, the guess is flagged and the search then resumes where it stopped
+template<class Solver> void check_interrupted_guess(unsigned int& nb_failures) {
+    Solver solver(5, 8);
+    Solver reference(5, 8);
+    auto feedback_calculator = solver.get_feedback_calculator();
+    feedback_calculator.set_secret(Code{ 7, 6, 5, 4, 3 });
+    for (unsigned int i = 0; i < 2; ++i) {
+        const auto& [guess, guess_frequency_map] = reference.next_guess();
+        const Feedback feedback = feedback_calculator.get_feedback(guess, guess_frequency_map);
+        solver.next_guess();
+        solver.apply_feedback(feedback);
+        reference.apply_feedback(feedback);
+    }
+
+    // As in a game loop, asking whether to go on leaves the whole search to the capped move
+    CHECK(solver.can_continue());
+    const auto [partial_guess, partial_guess_frequency_map, guess_quality] = solver.next_guess(SearchBudget(std::chrono::nanoseconds(0)));
+    CHECK(guess_quality == GuessQuality::partial);
+    CHECK(solver.can_continue());
+
+    const auto& [guess, guess_frequency_map] = solver.next_guess();
+    const auto& [reference_guess, reference_guess_frequency_map] = reference.next_guess();
+    CHECK(std::ranges::equal(guess | std::views::take(5), reference_guess | std::views::take(5)));
+}
+
+
+// Neither the permutation engine arranging the colors once they are all known nor the check orders reordering the history
+// may change the games, they must be the ones of the plain backtrack, which plays the first consistent code in
+// lexicographic order. The games are played against every secret of the board, or one every stride secrets.
+template<class Solver, class FrequencyMap, class... Args>
+void check_first_consistent_games(unsigned int& nb_failures, std::uint8_t pegs, std::uint8_t colors, bool distinct_colors, size_t stride, Args... args) {
+    const std::vector<Code> codes = all_codes(pegs, colors, distinct_colors);
+    unsigned int nb_different = 0;
+    for (size_t i = 0; i < codes.size(); i += stride) {
+        Solver solver(pegs, colors, args...);
+        nb_different += play(solver, codes[i]) != play_first_consistent<Solver, FrequencyMap>(pegs, colors, codes, codes[i]);
+    }
+    CHECK(nb_different == 0);
+}
+
+// With every move interrupted at once the guesses come from the frontier of each search mode, they never repeat
+// a code already played and the games still end
+template<class Solver, class... Args> void check_capped_games(unsigned int& nb_failures, bool distinct_colors, Args... args) {
+    unsigned int nb_unfinished = 0;
+    unsigned int nb_repeated = 0;
+    for (const Code& secret : all_codes(4, 6, distinct_colors)) {
+        Solver solver(4, 6, args...);
+        auto guesses = play_capped(solver, secret, std::chrono::nanoseconds(0), 100);
+        nb_unfinished += guesses.empty() || guesses.back() != secret;
+        std::ranges::sort(guesses);
+        nb_repeated += std::ranges::adjacent_find(guesses) != guesses.end();
+    }
+    CHECK(nb_unfinished == 0);
+    CHECK(nb_repeated == 0);
+}
+
+}
+
+TEST(duplicate_no_candidate_left) {
+    check_no_candidate_left<duplicate::Solver>(nb_failures);
+    check_no_candidate_left_bounded<duplicate::Solver>(nb_failures);
+}
+
+TEST(duplicate_interrupted_guess) {
+    check_interrupted_guess<duplicate::Solver>(nb_failures);
+    check_capped_games<duplicate::Solver>(nb_failures, false, duplicate::SearchEngine::backtrack);
+    check_capped_games<duplicate::Solver>(nb_failures, false, duplicate::SearchEngine::two_level);
+}
+
+TEST(duplicate_permutation_engine_follows_backtrack) {
+    check_first_consistent_games<duplicate::Solver, duplicate::FrequencyMap>(nb_failures, 4, 6, false, 1, duplicate::SearchEngine::backtrack);
+}
+
+// The searches of 5x8 reorder their check orders close to a hundred times over these games
+TEST(duplicate_check_order_keeps_guesses) {
+    check_first_consistent_games<duplicate::Solver, duplicate::FrequencyMap>(nb_failures, 5, 8, false, 128, duplicate::SearchEngine::backtrack);
+}
+
+// The two level search only reaches the codes of the backtrack sooner, the games are the same
+TEST(duplicate_two_level_follows_backtrack) {
+    unsigned int nb_different = 0;
+    for (const Code& secret : all_codes(5, 7, false)) {
+        duplicate::Solver backtrack_solver(5, 7, duplicate::SearchEngine::backtrack);
+        duplicate::Solver two_level_solver(5, 7, duplicate::SearchEngine::two_level);
+        nb_different += play(backtrack_solver, secret) != play(two_level_solver, secret);
+    }
+    CHECK(nb_different == 0);
+}
+
+TEST(permutation_engine_rejects_too_many_pegs) {
+    bool rejected = false;
+    try {
+        PermutationEngine permutation_engine(PermutationEngine::max_pegs + 1);
+    }
+    catch (const std::invalid_argument&) {
+        rejected = true;
+    }
+    CHECK(rejected);
+}
+
+TEST(no_duplicate_no_candidate_left) {
+    check_no_candidate_left<no_duplicate::Solver>(nb_failures);
+    check_no_candidate_left_bounded<no_duplicate::Solver>(nb_failures);
+}
+
+TEST(no_duplicate_interrupted_guess) {
+    check_interrupted_guess<no_duplicate::Solver>(nb_failures);
+    check_capped_games<no_duplicate::Solver>(nb_failures, true);
+}
+
+TEST(no_duplicate_permutation_engine_follows_backtrack) {
+    check_first_consistent_games<no_duplicate::Solver, no_duplicate::FrequencyMap>(nb_failures, 5, 7, true, 1);
+}
+
+// Pegs placed, recolored and removed as the search does, over several words and up to the last bit of a lane: the planes
+// must always be the ones of the pegs placed and give the same black pegs as the code
+TEST(no_duplicate_position_planes_follow_code) {
+    const std::uint8_t pegs = 10;
+    const std::uint8_t colors = no_duplicate::bitset_size;
+    std::mt19937 random(2024);
+    std::uniform_int_distribution<unsigned int> draw_color(0, colors - 1);
+    Code guess(pegs);
+    for (size_t i = 0; i < pegs; ++i) {
+        guess[i] = static_cast<Color>(i * 3 % colors);
+    }
+    const no_duplicate::PositionPlanes guess_planes = no_duplicate::make_position_planes(guess, pegs);
+
+    Code code(pegs, 0);
+    size_t nb_placed = 0;
+    no_duplicate::PositionPlanes planes((pegs + no_duplicate::positions_per_word - 1) / no_duplicate::positions_per_word, 0);
+    const auto draw_unused_color = [&] {
+        Color color;
+        do {
+            color = static_cast<Color>(draw_color(random));
+        } while (std::ranges::find(code.begin(), code.begin() + nb_placed, color) != code.begin() + nb_placed);
+        return color;
+    };
+
+    unsigned int nb_inconsistent = 0;
+    for (unsigned int i = 0; i < 10000; ++i) {
+        const unsigned int action = draw_color(random) % 3;
+        if (nb_placed < pegs && (action == 0 || nb_placed == 0)) {
+            code[nb_placed] = draw_unused_color();
+            no_duplicate::toggle_peg(planes, nb_placed, code[nb_placed]);
+            ++nb_placed;
+        }
+        else if (action == 1) {
+            --nb_placed;
+            no_duplicate::toggle_peg(planes, nb_placed, code[nb_placed]);
+        }
+        else {
+            no_duplicate::toggle_peg(planes, nb_placed - 1, code[nb_placed - 1]);
+            --nb_placed;
+            code[nb_placed] = draw_unused_color();
+            no_duplicate::toggle_peg(planes, nb_placed, code[nb_placed]);
+            ++nb_placed;
+        }
+
+        no_duplicate::PositionPlanes expected = no_duplicate::make_position_planes(code, nb_placed);
+        expected.resize(planes.size(), 0);
+        nb_inconsistent += planes != expected
+            || (nb_placed != 0 && no_duplicate::count_black_pegs(planes, guess_planes, nb_placed - 1) != no_duplicate::count_black_pegs(code, guess, nb_placed - 1));
+    }
+    CHECK(nb_inconsistent == 0);
+}
+
+// And the ones of 5x10 more than a hundred times
+TEST(no_duplicate_check_order_keeps_guesses) {
+    check_first_consistent_games<no_duplicate::Solver, no_duplicate::FrequencyMap>(nb_failures, 5, 10, true, 64);
+}
+
+// Without any code left the guess is cleared, the guess already played is not offered again
+TEST(monte_carlo_stops_without_candidates) {
+    duplicate::MonteCarloSolver solver(4, 6);
+    CHECK(solver.can_continue());
+    solver.next_guess();
+    solver.apply_feedback(Feedback(3, 1));
+
+    const auto& [guess, guess_frequency_map] = solver.next_guess();
+    CHECK(!solver.can_continue());
+    CHECK(std::ranges::all_of(guess_frequency_map, [](std::uint8_t count) { return count == 0; }));
+}
+
+TEST(monte_carlo_never_repeats_a_guess) {
+    unsigned int nb_unfinished = 0;
+    unsigned int nb_repeated = 0;
+    const std::vector<Code> secrets = all_codes(4, 6, false);
+    for (size_t i = 0; i < secrets.size(); i += 16) {
+        duplicate::MonteCarloSolver solver(4, 6);
+        auto guesses = play(solver, secrets[i]);
+        nb_unfinished += guesses.empty() || guesses.back() != secrets[i];
+        std::ranges::sort(guesses);
+        nb_repeated += std::ranges::adjacent_find(guesses) != guesses.end();
+    }
+    CHECK(nb_unfinished == 0);
+    CHECK(nb_repeated == 0);
+}
+
+TEST(genetic_stops_without_candidates) {
+    duplicate::GeneticSolver solver(4, 6);
+    CHECK(solver.can_continue());
+    solver.next_guess();
+    solver.apply_feedback(Feedback(3, 1));
+    CHECK(!solver.can_continue());
+
+    const auto& [guess, guess_frequency_map] = solver.next_guess();
+    CHECK(std::ranges::all_of(guess_frequency_map, [](std::uint8_t count) { return count == 0; }));
+}
+
+// Without any generation the population never changes, the fittest codes are played once each and the game
+// stops when they all were
+TEST(genetic_never_repeats_a_guess) {
+    duplicate::GeneticSettings settings;
+    settings.population_size = 4;
+    settings.max_generations = 0;
+    duplicate::GeneticSolver solver(4, 6, settings);
+    auto guesses = play(solver, Code{ 5, 5, 5, 5 });
+    CHECK(!solver.can_continue());
+    CHECK(!guesses.empty() && guesses.size() <= 4);
+    std::ranges::sort(guesses);
+    CHECK(std::ranges::adjacent_find(guesses) == guesses.end());
+
+    unsigned int nb_unfinished = 0;
+    unsigned int nb_repeated = 0;
+    const std::vector<Code> secrets = all_codes(4, 6, false);
+    for (size_t i = 0; i < secrets.size(); i += 16) {
+        duplicate::GeneticSolver game_solver(4, 6);
+        auto game_guesses = play(game_solver, secrets[i]);
+        nb_unfinished += game_guesses.empty() || game_guesses.back() != secrets[i];
+        std::ranges::sort(game_guesses);
+        nb_repeated += std::ranges::adjacent_find(game_guesses) != game_guesses.end();
+    }
+    CHECK(nb_unfinished == 0);
+    CHECK(nb_repeated == 0);
+}
+
+TEST(genetic_stops_at_guess_limit) {
+    duplicate::GeneticSettings settings;
+    settings.max_guesses = 2;
+    duplicate::GeneticSolver solver(4, 6, settings);
+    for (unsigned int i = 0; i < 2; ++i) {
+        CHECK(solver.can_continue());
+        solver.next_guess();
+        solver.apply_feedback(Feedback(0, 0));
+    }
+    CHECK(!solver.can_continue());
+}
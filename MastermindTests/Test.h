@@ -0,0 +1,37 @@
+#pragma once
+
+#include <functional>
+#include <iostream>
+#include <string_view>
+#include <vector>
+
+
+// Minimal test harness: every TEST registers itself at startup, main runs them all and reports the failed checks
+struct TestCase {
+    std::string_view name;
+    std::function<void(unsigned int&)> run;
+};
+
+inline std::vector<TestCase>& get_test_cases() {
+    static std::vector<TestCase> test_cases;
+    return test_cases;
+}
+
+struct TestRegistration {
+    TestRegistration(std::string_view name, void (*run)(unsigned int&)) {
+        get_test_cases().push_back({ name, run });
+    }
+};
+
+#define TEST(name) \
+    static void name(unsigned int& nb_failures); \
+    static const TestRegistration name##_registration(#name, name); \
+    static void name(unsigned int& nb_failures)
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            ++nb_failures; \
+            std::cout << __FILE__ << ":" << __LINE__ << ": check failed: " << #condition << std::endl; \
+        } \
+    } while (false)